@@ -0,0 +1,96 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+
+#include "xeus/xauthentication.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const xauthentication& get_bench_authentication()
+        {
+            // Shared by all the benchmark threads
+            static std::unique_ptr<xauthentication> auth =
+                make_xauthentication("hmac-sha256", "a0436f6c-1916-498b-8eb9-e81ab9368e84");
+            return *auth;
+        }
+
+        int max_bench_threads()
+        {
+            unsigned int n = std::thread::hardware_concurrency();
+            return n == 0 ? 1 : static_cast<int>(n);
+        }
+    }
+
+    void xauthentication_sign(benchmark::State& state)
+    {
+        const xauthentication& auth = get_bench_authentication();
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::string header(200, 'h');
+        std::string parent_header(200, 'p');
+        std::string metadata(2, 'm');
+        std::string content(size, 'c');
+        zmq::message_t header_msg(header.begin(), header.end());
+        zmq::message_t parent_header_msg(parent_header.begin(), parent_header.end());
+        zmq::message_t metadata_msg(metadata.begin(), metadata.end());
+        zmq::message_t content_msg(content.begin(), content.end());
+        for (auto _ : state)
+        {
+            zmq::message_t sig = auth.sign(header_msg, parent_header_msg, metadata_msg, content_msg);
+            benchmark::DoNotOptimize(sig.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    }
+    BENCHMARK(xauthentication_sign)->Arg(1024)->ThreadRange(1, max_bench_threads())->UseRealTime();
+
+    void xauthentication_verify(benchmark::State& state)
+    {
+        const xauthentication& auth = get_bench_authentication();
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::string content(size, 'c');
+        zmq::message_t header_msg(200);
+        zmq::message_t parent_header_msg(200);
+        zmq::message_t metadata_msg(2);
+        zmq::message_t content_msg(content.begin(), content.end());
+        zmq::message_t sig = auth.sign(header_msg, parent_header_msg, metadata_msg, content_msg);
+        for (auto _ : state)
+        {
+            bool valid = auth.verify(sig, header_msg, parent_header_msg, metadata_msg, content_msg);
+            benchmark::DoNotOptimize(valid);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    }
+    BENCHMARK(xauthentication_verify)->Range(1 << 10, 8 << 20);
+
+    void xauthentication_scheme_sign(benchmark::State& state, const char* scheme)
+    {
+        auto auth = make_xauthentication(scheme, "a0436f6c-1916-498b-8eb9-e81ab9368e84");
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        std::string content(size, 'c');
+        zmq::message_t header_msg(200);
+        zmq::message_t parent_header_msg(200);
+        zmq::message_t metadata_msg(2);
+        zmq::message_t content_msg(content.begin(), content.end());
+        for (auto _ : state)
+        {
+            zmq::message_t sig = auth->sign(header_msg, parent_header_msg, metadata_msg, content_msg);
+            benchmark::DoNotOptimize(sig.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    }
+    BENCHMARK_CAPTURE(xauthentication_scheme_sign, hmac_sha256, "hmac-sha256")->Range(1 << 10, 8 << 20);
+    BENCHMARK_CAPTURE(xauthentication_scheme_sign, hmac_sha512, "hmac-sha512")->Range(1 << 10, 8 << 20);
+    BENCHMARK_CAPTURE(xauthentication_scheme_sign, blake2b, "blake2b")->Range(1 << 10, 8 << 20);
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "xeus/xcomm.hpp"
+#include "xeus/xguid.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        using comm_list = std::vector<std::unique_ptr<xcomm>>;
+
+        comm_list make_comms(xcomm_manager& manager, std::size_t count)
+        {
+            manager.register_comm_target("bench", [](xcomm&&, const xmessage&) {});
+            xtarget* target = manager.target("bench");
+            comm_list comms;
+            comms.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                comms.emplace_back(new xcomm(target));
+            }
+            return comms;
+        }
+    }
+
+    void xcomm_manager_find(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        xcomm_manager manager;
+        comm_list comms = make_comms(manager, count);
+        // Ids are looked up as they are read from a message
+        std::vector<std::string> ids;
+        for (const auto& comm : comms)
+        {
+            xguid id = comm->id();
+            ids.emplace_back(id.c_str(), id.size());
+        }
+
+        std::size_t i = 0;
+        for (auto _ : state)
+        {
+            const std::string& id = ids[i];
+            xcomm* comm = manager.comms().find(id.c_str(), id.size());
+            benchmark::DoNotOptimize(comm);
+            i = i + 1 == count ? 0 : i + 1;
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    }
+    BENCHMARK(xcomm_manager_find)->RangeMultiplier(10)->Range(1, 100000);
+
+    void xcomm_manager_find_missing(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        xcomm_manager manager;
+        comm_list comms = make_comms(manager, count);
+        xguid missing = new_xguid();
+        for (auto _ : state)
+        {
+            xcomm* comm = manager.comms().find(missing);
+            benchmark::DoNotOptimize(comm);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    }
+    BENCHMARK(xcomm_manager_find_missing)->RangeMultiplier(10)->Range(1, 100000);
+}
@@ -0,0 +1,36 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <thread>
+
+#include "benchmark/benchmark.h"
+
+#include "xeus/xguid.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        int max_bench_threads()
+        {
+            unsigned int n = std::thread::hardware_concurrency();
+            return n == 0 ? 1 : static_cast<int>(n);
+        }
+    }
+
+    void xguid_new(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            xguid id = new_xguid();
+            benchmark::DoNotOptimize(id.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    }
+    BENCHMARK(xguid_new)->ThreadRange(1, max_bench_threads())->UseRealTime();
+}
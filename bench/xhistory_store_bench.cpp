@@ -0,0 +1,62 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "xeus/xhistory_store.hpp"
+#include "xeus/xinterpreter.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        std::string make_input(std::size_t i)
+        {
+            return "result_" + std::to_string(i) + " = compute(data[" + std::to_string(i % 97) + "])";
+        }
+
+        xhistory_arguments make_search(const std::string& pattern)
+        {
+            xhistory_arguments args;
+            args.m_hist_access_type = "search";
+            args.m_output = false;
+            args.m_raw = true;
+            args.m_session = 0;
+            args.m_start = 0;
+            args.m_stop = 0;
+            args.m_n = 10;
+            args.m_pattern = pattern;
+            args.m_unique = false;
+            return args;
+        }
+    }
+
+    // Search for a single input among range(0) entries
+    void xhistory_store_search(benchmark::State& state)
+    {
+        std::size_t count = static_cast<std::size_t>(state.range(0));
+        xhistory_store store;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            store.append(static_cast<int>(i + 1), make_input(i));
+        }
+
+        xhistory_arguments args = make_search("result_" + std::to_string(count / 2) + " = *");
+        for (auto _ : state)
+        {
+            xjson reply = store.history_request(args);
+            benchmark::DoNotOptimize(reply);
+        }
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+    }
+    BENCHMARK(xhistory_store_search)->Arg(1000)->Arg(200000)->Unit(benchmark::kMicrosecond);
+}
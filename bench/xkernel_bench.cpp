@@ -0,0 +1,187 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+#include "xeus/make_unique.hpp"
+#include "xeus/xauthentication.hpp"
+#include "xeus/xguid.hpp"
+#include "xeus/xkernel.hpp"
+#include "xeus/xkernel_configuration.hpp"
+#include "xeus/xmessage.hpp"
+#include "xeus/xserver.hpp"
+#include "xmock_interpreter.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        std::string get_end_point(const xconfiguration& config, const std::string& port)
+        {
+            return config.m_transport + "://" + config.m_ip + ':' + port;
+        }
+
+        // The kernel binds its channels to ports picked by the system,
+        // see xserver::update_ports.
+        xconfiguration make_bench_configuration()
+        {
+            xconfiguration config;
+            config.m_transport = "tcp";
+            config.m_ip = "127.0.0.1";
+            config.m_control_port = "0";
+            config.m_shell_port = "0";
+            config.m_stdin_port = "0";
+            config.m_iopub_port = "0";
+            config.m_hb_port = "0";
+            config.m_signature_scheme = "hmac-sha256";
+            config.m_key = "a0436f6c-1916-498b-8eb9-e81ab9368e84";
+            return config;
+        }
+
+        // Drives the kernel like a front-end would, see example/echo_client
+        class xbench_client
+        {
+        public:
+
+            xbench_client(zmq::context_t& context, const xconfiguration& config)
+                : m_shell(context, zmq::socket_type::dealer),
+                  m_control(context, zmq::socket_type::dealer),
+                  p_auth(make_xauthentication(config.m_signature_scheme, config.m_key)),
+                  m_session_id(new_xguid())
+            {
+                m_shell.setsockopt(ZMQ_LINGER, 0);
+                m_shell.connect(get_end_point(config, config.m_shell_port));
+                m_control.setsockopt(ZMQ_LINGER, 0);
+                m_control.connect(get_end_point(config, config.m_control_port));
+            }
+
+            void send_request(const std::string& msg_type, xjson content = xjson::object())
+            {
+                send(m_shell, msg_type, std::move(content));
+            }
+
+            void receive_reply()
+            {
+                receive(m_shell);
+            }
+
+            void shutdown()
+            {
+                xjson content;
+                content["restart"] = false;
+                send(m_control, "shutdown_request", std::move(content));
+                receive(m_control);
+            }
+
+        private:
+
+            void send(zmq::socket_t& socket, const std::string& msg_type, xjson content)
+            {
+                xmessage msg(xmessage::guid_list(),
+                             make_header(msg_type, "bench", m_session_id),
+                             xjson::object(),
+                             xjson::object(),
+                             std::move(content));
+                zmq::multipart_t wire_msg;
+                msg.serialize(wire_msg, *p_auth);
+                wire_msg.send(socket);
+            }
+
+            void receive(zmq::socket_t& socket)
+            {
+                zmq::multipart_t wire_msg;
+                wire_msg.recv(socket);
+                xmessage msg;
+                msg.deserialize(wire_msg, *p_auth);
+            }
+
+            zmq::socket_t m_shell;
+            zmq::socket_t m_control;
+            std::unique_ptr<xauthentication> p_auth;
+            std::string m_session_id;
+        };
+
+        double percentile(std::vector<double>& values, double p)
+        {
+            if (values.empty())
+            {
+                return 0.;
+            }
+            std::size_t index = static_cast<std::size_t>(p / 100. * static_cast<double>(values.size() - 1));
+            std::nth_element(values.begin(), values.begin() + index, values.end());
+            return values[index];
+        }
+    }
+
+    /**
+     * Sends batches of range(0) kernel_info_requests on shell and waits
+     * for the replies, through a kernel listening on the loopback. With
+     * one request per batch, the p99 counter is the p99 round trip.
+     */
+    void xkernel_kernel_info(benchmark::State& state)
+    {
+        std::size_t window = static_cast<std::size_t>(state.range(0));
+        zmq::context_t context;
+        xconfiguration config = make_bench_configuration();
+        // The server is built here so that the channels are bound
+        // before the client connects.
+        std::unique_ptr<xserver> server = make_xserver(context, config);
+        server->update_ports(config);
+
+        xkernel kernel(config, "bench", ::xeus::make_unique<xmock_interpreter>());
+        std::thread kernel_thread([&kernel, &context, &server]()
+        {
+            kernel.start(context, std::move(server));
+        });
+
+        xbench_client client(context, config);
+        // Waits for the kernel to be started
+        client.send_request("kernel_info_request");
+        client.receive_reply();
+
+        using clock_type = std::chrono::steady_clock;
+        std::vector<double> latencies;
+        latencies.reserve(100000);
+        for (auto _ : state)
+        {
+            auto start = clock_type::now();
+            for (std::size_t i = 0; i < window; ++i)
+            {
+                client.send_request("kernel_info_request");
+            }
+            for (std::size_t i = 0; i < window; ++i)
+            {
+                client.receive_reply();
+            }
+            std::chrono::duration<double, std::micro> elapsed = clock_type::now() - start;
+            latencies.push_back(elapsed.count());
+        }
+
+        client.shutdown();
+        kernel_thread.join();
+
+        std::int64_t requests = static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(window);
+        state.SetItemsProcessed(requests);
+        state.counters["requests_per_second"] = benchmark::Counter(static_cast<double>(requests), benchmark::Counter::kIsRate);
+        state.counters["p50_us"] = percentile(latencies, 50.);
+        state.counters["p99_us"] = percentile(latencies, 99.);
+    }
+    BENCHMARK(xkernel_kernel_info)->Arg(1)->Arg(16)->UseRealTime();
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "xeus/xauthentication.hpp"
+#include "xeus/xguid.hpp"
+#include "xeus/xmessage.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        xjson make_stream_content(std::size_t size)
+        {
+            xjson content;
+            content["name"] = "stdout";
+            content["text"] = std::string(size, 'x');
+            return content;
+        }
+
+        xpub_message make_stream_message(std::size_t size)
+        {
+            return xpub_message("kernel_core.bench.stream",
+                                make_header("stream", "bench", "session"),
+                                xjson::object(),
+                                xjson::object(),
+                                make_stream_content(size));
+        }
+
+        // Former implementation: the JSON document is dumped into a
+        // temporary string which is then copied into the frame.
+        zmq::message_t copy_zmq_message(const xjson& json)
+        {
+            std::string buffer = json.dump();
+            return zmq::message_t(buffer.c_str(), buffer.size());
+        }
+
+        void release_buffer(void* /*data*/, void* hint)
+        {
+            delete static_cast<std::string*>(hint);
+        }
+
+        // Current implementation: the frame takes ownership of the buffer
+        // the JSON document is dumped into.
+        zmq::message_t zero_copy_zmq_message(const xjson& json)
+        {
+            std::string* buffer = new std::string(json.dump());
+            return zmq::message_t(&(*buffer)[0], buffer->size(), release_buffer, buffer);
+        }
+    }
+
+    void xmessage_copy_serialize(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        xjson content = make_stream_content(size);
+        for (auto _ : state)
+        {
+            zmq::message_t frame = copy_zmq_message(content);
+            benchmark::DoNotOptimize(frame.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    }
+    BENCHMARK(xmessage_copy_serialize)->RangeMultiplier(10)->Range(100, 10 << 20);
+
+    void xmessage_zero_copy_serialize(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        xjson content = make_stream_content(size);
+        for (auto _ : state)
+        {
+            zmq::message_t frame = zero_copy_zmq_message(content);
+            benchmark::DoNotOptimize(frame.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    }
+    BENCHMARK(xmessage_zero_copy_serialize)->RangeMultiplier(10)->Range(100, 10 << 20);
+
+    void xmessage_serialize(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        // No authentication so that only the serialization is measured
+        auto auth = make_xauthentication("", "");
+        xpub_message msg = make_stream_message(size);
+        for (auto _ : state)
+        {
+            zmq::multipart_t wire_msg;
+            msg.serialize(wire_msg, *auth);
+            benchmark::DoNotOptimize(wire_msg.size());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    }
+    BENCHMARK(xmessage_serialize)->RangeMultiplier(10)->Range(100, 10 << 20);
+
+    void xmessage_deserialize(benchmark::State& state)
+    {
+        std::size_t size = static_cast<std::size_t>(state.range(0));
+        auto auth = make_xauthentication("", "");
+        zmq::multipart_t reference;
+        make_stream_message(size).serialize(reference, *auth);
+        for (auto _ : state)
+        {
+            // Frames are shared with the reference message, not copied
+            state.PauseTiming();
+            zmq::multipart_t wire_msg;
+            for (std::size_t i = 0; i < reference.size(); ++i)
+            {
+                zmq::message_t part;
+                part.copy(reference.peek(i));
+                wire_msg.add(std::move(part));
+            }
+            state.ResumeTiming();
+
+            xpub_message msg;
+            msg.deserialize(wire_msg, *auth);
+            // Parts are parsed lazily, the content is accessed so that
+            // parsing is measured as well.
+            benchmark::DoNotOptimize(msg.content().size());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    }
+    BENCHMARK(xmessage_deserialize)->RangeMultiplier(10)->Range(100, 10 << 20);
+
+    void xmessage_make_header(benchmark::State& state)
+    {
+        std::string user_name = "bench";
+        std::string session_id = new_xguid();
+        for (auto _ : state)
+        {
+            xjson header = make_header("execute_reply", user_name, session_id);
+            benchmark::DoNotOptimize(header.size());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    }
+    BENCHMARK(xmessage_make_header);
+}
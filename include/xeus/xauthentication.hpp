@@ -9,6 +9,7 @@
 #ifndef XAUTHENTICATION_HPP
 #define XAUTHENTICATION_HPP
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -18,6 +19,45 @@
 namespace xeus
 {
 
+    /**
+     * @class xsigner
+     * @brief Computes the signature of a message incrementally.
+     *
+     * The parts of the message are fed in order with update, and final
+     * returns the hexdigest of everything fed so far. This allows to sign
+     * each frame as soon as it is serialized, and to sign data which is
+     * not held in a zmq::message_t. A signer must not be updated after
+     * final or verify has been called.
+     */
+    class XEUS_API xsigner
+    {
+    public:
+
+        virtual ~xsigner() = default;
+
+        xsigner(const xsigner&) = delete;
+        xsigner& operator=(const xsigner&) = delete;
+
+        xsigner(xsigner&&) = delete;
+        xsigner& operator=(xsigner&&) = delete;
+
+        void update(const void* data, std::size_t size);
+        void update(const zmq::message_t& frame);
+
+        zmq::message_t final();
+        bool verify(const zmq::message_t& signature);
+
+    protected:
+
+        xsigner() = default;
+
+    private:
+
+        virtual void update_impl(const unsigned char* data, std::size_t size) = 0;
+        virtual zmq::message_t final_impl() = 0;
+        virtual bool verify_impl(const zmq::message_t& signature) = 0;
+    };
+
     class XEUS_API xauthentication
     {
     public:
@@ -41,6 +81,9 @@ namespace xeus
                     const zmq::message_t& meta_data,
                     const zmq::message_t& content) const;
 
+        // The signer may be used from any thread
+        std::unique_ptr<xsigner> make_signer() const;
+
     protected:
 
         xauthentication() = default;
@@ -57,6 +100,8 @@ namespace xeus
                                  const zmq::message_t& parent_header,
                                  const zmq::message_t& meta_data,
                                  const zmq::message_t& content) const = 0;
+
+        virtual std::unique_ptr<xsigner> make_signer_impl() const = 0;
     };
 
     XEUS_API
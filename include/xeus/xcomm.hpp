@@ -9,10 +9,14 @@
 #ifndef XCOMM_HPP
 #define XCOMM_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "xguid.hpp"
 #include "xmessage.hpp"
@@ -46,7 +50,9 @@ namespace xeus
 
         void operator()(xcomm&& comm, const xmessage& request) const;
 
-        void publish_message(const std::string&, xjson, xjson) const;
+        using buffer_sequence = xmessage::buffer_sequence;
+
+        void publish_message(const std::string&, xjson, xjson, buffer_sequence) const;
 
         void register_comm(xguid, xcomm*) const;
         void unregister_comm(xguid) const;
@@ -72,6 +78,8 @@ namespace xeus
     public:
 
         using handler_type = std::function<void(const xmessage&)>;
+        using batch_handler_type = std::function<void(const std::vector<xmessage>&)>;
+        using buffer_sequence = xmessage::buffer_sequence;
 
         xcomm() = delete;
         ~xcomm();
@@ -83,20 +91,31 @@ namespace xeus
         xcomm& operator=(xcomm&&);
         xcomm& operator=(const xcomm&);
 
-        void open(xjson metadata, xjson data);
-        void close(xjson metadata, xjson data);
-        void send(xjson metadata, xjson data) const;
+        void open(xjson metadata, xjson data, buffer_sequence buffers = buffer_sequence());
+        void close(xjson metadata, xjson data, buffer_sequence buffers = buffer_sequence());
+        void send(xjson metadata, xjson data, buffer_sequence buffers = buffer_sequence()) const;
 
         xtarget& target() noexcept;
         const xtarget& target() const noexcept;
 
         void handle_message(const xmessage& request);
+        void handle_message_batch(const std::vector<xmessage>& requests);
         void handle_close(const xmessage& request);
 
         xguid id() const noexcept;
 
         template <class T>
         void on_message(T&& handler);
+        // Receives consecutive comm_msgs coalesced by the kernel, see
+        // xcomm_manager::set_message_coalescing. Without a batch handler,
+        // the messages of a batch are passed one by one to the message
+        // handler, each of them being the parent of the messages sent
+        // while it is handled. Messages sent by a batch handler have the
+        // first message of the batch as parent. Handlers only interested
+        // in the latest state can use the last message of the batch.
+        template <class T>
+        void on_message_batch(T&& handler);
+        bool has_batch_handler() const noexcept;
         template <class T>
         void on_close(T&& handler);
 
@@ -113,16 +132,91 @@ namespace xeus
          *    "data": specified data
          * }
          */
-        void send_comm_message(const std::string& msg_type, xjson metadata, xjson data) const;
-        void send_comm_message(const std::string& msg_type, xjson metadata, xjson data, const std::string& target_name) const;
+        void send_comm_message(const std::string& msg_type, xjson metadata, xjson data,
+                               buffer_sequence buffers) const;
+        void send_comm_message(const std::string& msg_type, xjson metadata, xjson data,
+                               buffer_sequence buffers, const std::string& target_name) const;
 
         handler_type m_close_handler;
         handler_type m_message_handler;
+        batch_handler_type m_batch_handler;
         xtarget* p_target;
         xguid m_id;
         bool m_moved_from;
     };
 
+    /*************************
+     * xcomm_map declaration *
+     *************************/
+
+    /**
+     * @class xcomm_map
+     * @brief Registry of the comms, indexed by comm id.
+     *
+     * Comms are stored contiguously so iterating over them is cheap, and
+     * indexed by an open addressing table. Ids made of 32 lower case hex
+     * digits (the form generated by xeus and by the Jupyter front-ends)
+     * are hashed and compared as 128-bit values; other ids fall back to
+     * a string comparison. Lookups accept raw character ranges, so an id
+     * can be searched directly from the content of a message.
+     */
+    class XEUS_API xcomm_map
+    {
+    public:
+
+        using value_type = std::pair<xguid, xcomm*>;
+        using container_type = std::vector<value_type>;
+        using const_iterator = container_type::const_iterator;
+        using iterator = const_iterator;
+        using size_type = std::size_t;
+
+        xcomm_map();
+
+        size_type size() const noexcept;
+        bool empty() const noexcept;
+
+        const_iterator begin() const noexcept;
+        const_iterator end() const noexcept;
+        const_iterator cbegin() const noexcept;
+        const_iterator cend() const noexcept;
+
+        // Returns nullptr if no comm is registered with this id
+        xcomm* find(const char* id, size_type size) const;
+        xcomm* find(const xguid& id) const;
+
+        // Replaces the comm if the id is already registered
+        void insert(const xguid& id, xcomm* comm);
+
+        void erase(const char* id, size_type size);
+        void erase(const xguid& id);
+
+        // Before xeus 0.12, xcomm_manager::comms() returned a
+        // std::map<xguid, xcomm*>. xcomm_map converts to it, but code
+        // which modifies the map, calls operator[] or compares the
+        // result of find with end() must be updated.
+        operator std::map<xguid, xcomm*>() const;
+
+    private:
+
+        struct key_type
+        {
+            std::uint64_t m_high;
+            std::uint64_t m_low;
+            bool m_hex;
+        };
+
+        static key_type make_key(const char* id, size_type size);
+        static size_type hash(const key_type& key);
+
+        bool matches(std::uint32_t index, const key_type& key, const char* id, size_type size) const;
+        size_type probe(const key_type& key, const char* id, size_type size) const;
+        void grow();
+
+        container_type m_values;
+        std::vector<key_type> m_keys;
+        std::vector<std::uint32_t> m_slots;
+    };
+
     /*****************************
      * xcomm_manager declaration *
      *****************************/
@@ -147,10 +241,19 @@ namespace xeus
         void comm_open(const xmessage& request);
         void comm_close(const xmessage& request);
         void comm_msg(const xmessage& request);
+        // requests must be comm_msgs for the same comm
+        void comm_msg_batch(const std::vector<xmessage>& requests);
+
+        // When enabled, the comm_msgs for the same comm queued on the
+        // shell channel are delivered as a single batch. Each of them
+        // still gets its busy and idle statuses, published before and
+        // after the whole batch. Disabled by default.
+        void set_message_coalescing(bool enabled) noexcept;
+        bool message_coalescing() const noexcept;
 
-        std::map<xguid, xcomm*>& comms() & noexcept;
-        const std::map<xguid, xcomm*>& comms() const & noexcept;
-        std::map<xguid, xcomm*> comms() const && noexcept;
+        xcomm_map& comms() & noexcept;
+        const xcomm_map& comms() const & noexcept;
+        xcomm_map comms() const && noexcept;
 
         xtarget* target(const std::string& target_name);
 
@@ -163,9 +266,10 @@ namespace xeus
 
         xjson get_metadata() const;
 
-        std::map<xguid, xcomm*> m_comms;
-        std::map<std::string, xtarget> m_targets;
+        xcomm_map m_comms;
+        std::unordered_map<std::string, xtarget> m_targets;
         xkernel_core* p_kernel;
+        bool m_message_coalescing;
     };
 
     /**************************
@@ -242,27 +346,44 @@ namespace xeus
         }
     }
 
-    inline void xcomm::send_comm_message(const std::string& msg_type, xjson metadata, xjson data) const
+    inline void xcomm::handle_message_batch(const std::vector<xmessage>& messages)
+    {
+        if (m_batch_handler)
+        {
+            m_batch_handler(messages);
+        }
+        else
+        {
+            for (const auto& message : messages)
+            {
+                handle_message(message);
+            }
+        }
+    }
+
+    inline void xcomm::send_comm_message(const std::string& msg_type, xjson metadata, xjson data,
+                                         buffer_sequence buffers) const
     {
         xjson content;
         content["comm_id"] = m_id;
         content["data"] = std::move(data);
-        target().publish_message(msg_type, std::move(metadata), std::move(content));
+        target().publish_message(msg_type, std::move(metadata), std::move(content), std::move(buffers));
     }
 
     inline void xcomm::send_comm_message(const std::string& msg_type, xjson metadata, xjson data,
-                                         const std::string& target_name) const
+                                         buffer_sequence buffers, const std::string& target_name) const
     {
         xjson content;
         content["comm_id"] = m_id;
         content["target_name"] = target_name;
         content["data"] = std::move(data);
-        target().publish_message(msg_type, std::move(metadata), std::move(content));
+        target().publish_message(msg_type, std::move(metadata), std::move(content), std::move(buffers));
     }
 
     inline xcomm::xcomm(xcomm&& comm)
         : m_close_handler(std::move(comm.m_close_handler)),
           m_message_handler(std::move(comm.m_message_handler)),
+          m_batch_handler(std::move(comm.m_batch_handler)),
           p_target(std::move(comm.p_target)),
           m_id(std::move(comm.m_id)),
           m_moved_from(false)
@@ -281,6 +402,7 @@ namespace xeus
     {
         m_close_handler = std::move(comm.m_close_handler);
         m_message_handler = std::move(comm.m_message_handler);
+        m_batch_handler = std::move(comm.m_batch_handler);
         p_target = std::move(comm.p_target);
         p_target->unregister_comm(m_id);
         m_id = std::move(comm.m_id);
@@ -320,19 +442,19 @@ namespace xeus
         }
     }
 
-    inline void xcomm::open(xjson metadata, xjson data)
+    inline void xcomm::open(xjson metadata, xjson data, buffer_sequence buffers)
     {
-        send_comm_message("comm_open", std::move(metadata), std::move(data), p_target->name());
+        send_comm_message("comm_open", std::move(metadata), std::move(data), std::move(buffers), p_target->name());
     }
 
-    inline void xcomm::close(xjson metadata, xjson data)
+    inline void xcomm::close(xjson metadata, xjson data, buffer_sequence buffers)
     {
-        send_comm_message("comm_close", std::move(metadata), std::move(data));
+        send_comm_message("comm_close", std::move(metadata), std::move(data), std::move(buffers));
     }
 
-    inline void xcomm::send(xjson metadata, xjson data) const
+    inline void xcomm::send(xjson metadata, xjson data, buffer_sequence buffers) const
     {
-        send_comm_message("comm_msg", std::move(metadata), std::move(data));
+        send_comm_message("comm_msg", std::move(metadata), std::move(data), std::move(buffers));
     }
 
     inline xguid xcomm::id() const noexcept
@@ -346,32 +468,102 @@ namespace xeus
         m_message_handler = std::forward<T>(handler);
     }
 
+    inline bool xcomm::has_batch_handler() const noexcept
+    {
+        return static_cast<bool>(m_batch_handler);
+    }
+
+    template <class T>
+    inline void xcomm::on_message_batch(T&& handler)
+    {
+        m_batch_handler = std::forward<T>(handler);
+    }
+
     template <class T>
     inline void xcomm::on_close(T&& handler)
     {
         m_close_handler = std::forward<T>(handler);
     }
 
+    /****************************
+     * xcomm_map implementation *
+     ****************************/
+
+    inline auto xcomm_map::size() const noexcept -> size_type
+    {
+        return m_values.size();
+    }
+
+    inline bool xcomm_map::empty() const noexcept
+    {
+        return m_values.empty();
+    }
+
+    inline auto xcomm_map::begin() const noexcept -> const_iterator
+    {
+        return m_values.begin();
+    }
+
+    inline auto xcomm_map::end() const noexcept -> const_iterator
+    {
+        return m_values.end();
+    }
+
+    inline auto xcomm_map::cbegin() const noexcept -> const_iterator
+    {
+        return m_values.cbegin();
+    }
+
+    inline auto xcomm_map::cend() const noexcept -> const_iterator
+    {
+        return m_values.cend();
+    }
+
+    inline xcomm* xcomm_map::find(const xguid& id) const
+    {
+        return find(id.c_str(), id.size());
+    }
+
+    inline void xcomm_map::erase(const xguid& id)
+    {
+        erase(id.c_str(), id.size());
+    }
+
+    inline xcomm_map::operator std::map<xguid, xcomm*>() const
+    {
+        return std::map<xguid, xcomm*>(m_values.begin(), m_values.end());
+    }
+
     /********************************
      * xcomm_manager implementation *
      ********************************/
 
+    inline void xcomm_manager::set_message_coalescing(bool enabled) noexcept
+    {
+        m_message_coalescing = enabled;
+    }
+
+    inline bool xcomm_manager::message_coalescing() const noexcept
+    {
+        return m_message_coalescing;
+    }
+
     inline xtarget* xcomm_manager::target(const std::string& target_name)
     {
         return &m_targets[target_name];
     }
 
-    inline std::map<xguid, xcomm*>& xcomm_manager::comms() & noexcept
+    inline xcomm_map& xcomm_manager::comms() & noexcept
     {
         return m_comms;
     }
 
-    inline const std::map<xguid, xcomm*>& xcomm_manager::comms() const & noexcept
+    inline const xcomm_map& xcomm_manager::comms() const & noexcept
     {
         return m_comms;
     }
 
-    inline std::map<xguid, xcomm*> xcomm_manager::comms() const && noexcept
+    inline xcomm_map xcomm_manager::comms() const && noexcept
     {
         return m_comms;
     }
@@ -21,13 +21,13 @@
 
 // Project version
 #define XEUS_VERSION_MAJOR 0
-#define XEUS_VERSION_MINOR 11
+#define XEUS_VERSION_MINOR 12
 #define XEUS_VERSION_PATCH 0
 
 // Binary version
-#define XEUS_BINARY_CURRENT 1
+#define XEUS_BINARY_CURRENT 2
 #define XEUS_BINARY_REVISION 0
-#define XEUS_BINARY_AGE 1
+#define XEUS_BINARY_AGE 0
 
 // Kernel protocol version
 #define XEUS_KERNEL_PROTOCOL_VERSION_MAJOR 5
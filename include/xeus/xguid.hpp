@@ -31,8 +31,14 @@ namespace xeus
     // Here we want a size of 64 bytes, which gives room for 55 characters (64 - 8 - 1).
     using xguid = xtl::xfixed_string<55>;
 
+    // Random (version 4) UUID, as 32 hexadecimal characters. Ids are drawn
+    // from a per-thread generator seeded once by the system UUID generator.
     XEUS_API xguid new_xguid();
 
+    // Time-ordered (version 7) UUID: ids generated later compare greater,
+    // at the precision of the system clock.
+    XEUS_API xguid new_time_ordered_xguid();
+
 }
 
 #endif
@@ -0,0 +1,98 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XHISTORY_STORE_HPP
+#define XHISTORY_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xeus.hpp"
+#include "xinterpreter.hpp"
+#include "xjson.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xhistory_store
+     * @brief Execution history that interpreters can delegate history_request to.
+     *
+     * Entries are appended to the current session, whose number follows
+     * the last session found in the history file. When a file is given,
+     * each entry is appended to it as a line of JSON and the previous
+     * sessions are loaded from it at construction.
+     *
+     * tail and range are answered from per-session indexes. search
+     * patterns use the glob syntax (* and ?); the candidates are the
+     * entries containing every trigram of the literal parts of the
+     * pattern, so that most entries are never matched. All methods
+     * are thread-safe, but a history file must not be shared by
+     * kernels running at the same time.
+     */
+    class XEUS_API xhistory_store
+    {
+    public:
+
+        xhistory_store();
+        explicit xhistory_store(const std::string& file_name);
+
+        xhistory_store(const xhistory_store&) = delete;
+        xhistory_store& operator=(const xhistory_store&) = delete;
+
+        int session() const noexcept;
+        std::size_t size() const;
+
+        // Typically called from execute_request_impl with the execution
+        // counter, when store_history is true.
+        void append(int line_number, const std::string& input, const std::string& output = "");
+
+        // Content of the history_reply
+        xjson history_request(const xhistory_arguments& args) const;
+
+    private:
+
+        struct entry
+        {
+            int m_session;
+            int m_line_number;
+            std::string m_input;
+            std::string m_output;
+        };
+
+        using index_list = std::vector<std::uint32_t>;
+
+        void load(const std::string& file_name);
+        void index(std::uint32_t position);
+
+        index_list tail(int n) const;
+        index_list range(int session, int start, int stop) const;
+        index_list search(const std::string& pattern, int n, bool unique) const;
+        // Returns false when the pattern has no trigram, every
+        // entry is then a candidate.
+        bool search_candidates(const std::string& pattern, index_list& candidates) const;
+
+        xjson make_reply(const index_list& positions, bool output) const;
+
+        mutable std::mutex m_mutex;
+        std::vector<entry> m_entries;
+        // Positions of the entries of each session
+        std::unordered_map<int, index_list> m_sessions;
+        std::unordered_map<std::uint32_t, index_list> m_trigrams;
+        int m_session;
+        std::ofstream m_file;
+    };
+
+}
+
+#endif
@@ -9,6 +9,7 @@
 #ifndef XINTERPRETER_HPP
 #define XINTERPRETER_HPP
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <vector>
@@ -72,13 +73,27 @@ namespace xeus
         xjson is_complete_request(const std::string& code);
         xjson kernel_info_request();
 
-        // publish(msg_type, metadata, content)
-        using publisher_type = std::function<void(const std::string&, xjson, xjson)>;
+        using buffer_sequence = xmessage::buffer_sequence;
+
+        // publish(msg_type, metadata, content, buffers). Before xeus
+        // 0.12, the publisher did not take the binary buffers: publishers
+        // registered by interpreters must take the fourth argument.
+        using publisher_type = std::function<void(const std::string&, xjson, xjson, buffer_sequence)>;
         void register_publisher(const publisher_type& publisher);
 
+        // publish(msg_type, content) for contents which are already
+        // serialized. When it is registered, publish_stream,
+        // publish_execution_input and clear_output write their content
+        // directly instead of building an xjson. Registering a publisher
+        // unregisters it.
+        using frame_publisher_type = std::function<void(const std::string&, xjson_frame)>;
+        void register_frame_publisher(const frame_publisher_type& publisher);
+
         void publish_stream(const std::string& name, const std::string& text);
-        void display_data(xjson data, xjson metadata, xjson transient);
-        void update_display_data(xjson data, xjson metadata, xjson transient);
+        void display_data(xjson data, xjson metadata, xjson transient,
+                          buffer_sequence buffers = buffer_sequence());
+        void update_display_data(xjson data, xjson metadata, xjson transient,
+                                 buffer_sequence buffers = buffer_sequence());
         void publish_execution_input(const std::string& code, int execution_count);
         void publish_execution_result(int execution_count, xjson data, xjson metadata);
         void publish_execution_error(const std::string& ename, const std::string& evalue,
@@ -94,9 +109,33 @@ namespace xeus
 
         void register_comm_manager(xcomm_manager* manager);
 
+        // True if complete, inspect and is_complete requests may be handled
+        // on worker threads, concurrently with an execute request.
+        bool concurrent_requests() const noexcept;
+
+        // handler(request content) -> reply content. Handlers are usually
+        // registered in configure_impl; an empty reply_type means that no
+        // reply is sent.
+        using request_handler_type = std::function<xjson(const xjson&)>;
+        void register_request_handler(const std::string& msg_type,
+                                      const std::string& reply_type,
+                                      const request_handler_type& handler);
+
+        // registrar(msg_type, reply_type, handler)
+        using handler_registrar_type = std::function<void(const std::string&,
+                                                          const std::string&,
+                                                          const request_handler_type&)>;
+        void register_handler_registrar(const handler_registrar_type& registrar);
+
         xcomm_manager& comm_manager() noexcept;
         const xcomm_manager& comm_manager() const noexcept;
 
+    protected:
+
+        // To be called by interpreters whose complete_request_impl,
+        // inspect_request_impl and is_complete_request_impl are thread safe.
+        void set_concurrent_requests(bool enabled) noexcept;
+
     private:
 
         virtual void configure_impl() = 0;
@@ -127,10 +166,21 @@ namespace xeus
 
         xjson build_display_content(xjson data, xjson metadata, xjson transient);
 
+        struct xpending_handler
+        {
+            std::string m_msg_type;
+            std::string m_reply_type;
+            request_handler_type m_handler;
+        };
+
         publisher_type m_publisher;
+        frame_publisher_type m_frame_publisher;
         stdin_sender_type m_stdin;
+        handler_registrar_type m_registrar;
+        std::vector<xpending_handler> m_pending_handlers;
         int m_execution_count;
         xcomm_manager* p_comm_manager;
+        std::atomic<bool> m_concurrent_requests;
     };
 
     inline xcomm_manager& xinterpreter::comm_manager() noexcept
@@ -142,6 +192,16 @@ namespace xeus
     {
         return *p_comm_manager;
     }
+
+    inline bool xinterpreter::concurrent_requests() const noexcept
+    {
+        return m_concurrent_requests;
+    }
+
+    inline void xinterpreter::set_concurrent_requests(bool enabled) noexcept
+    {
+        m_concurrent_requests = enabled;
+    }
 }
 
 #endif
@@ -12,7 +12,9 @@
 #include "xeus.hpp"
 #include "xinterpreter.hpp"
 #include "xkernel_configuration.hpp"
+#include "xmetrics.hpp"
 #include "xserver.hpp"
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -38,12 +40,28 @@ namespace xeus
 
         void start();
 
+        // Starts the kernel with a server built by the caller on a
+        // context it owns (see xkernel_host), the builder is not used.
+        void start(zmq::context_t& context, server_ptr server);
+
+        const xconfiguration& configuration() const noexcept;
+
+        // Metrics are shared by the kernels of the process, they
+        // are empty unless xeus is built with XEUS_ENABLE_METRICS.
+        xmetrics_snapshot metrics() const;
+
+        // Builds the interpreter replacing the current one when the
+        // kernel is restarted in process (see xconfiguration).
+        using interpreter_builder = std::function<interpreter_ptr()>;
+        void register_interpreter_builder(const interpreter_builder& builder);
+
     private:
 
         xconfiguration m_config;
         std::string m_user_name;
         interpreter_ptr p_interpreter;
         server_builder m_builder;
+        interpreter_builder m_interpreter_builder;
     };
 }
 
@@ -10,11 +10,34 @@
 #define XCONFIGURATION_HPP
 
 #include "xeus.hpp"
+#include <cstddef>
 #include <string>
+#include <vector>
 
 namespace xeus
 {
 
+    // Options of a socket bound on a Jupyter channel. Negative values
+    // keep the ZeroMQ defaults, except for the linger period which
+    // defaults to one second.
+    struct XEUS_API xsocket_options
+    {
+        int m_linger = -1;
+        int m_sndhwm = -1;
+        int m_rcvhwm = -1;
+        int m_sndbuf = -1;
+        int m_rcvbuf = -1;
+        int m_tcp_keepalive = -1;
+        int m_tcp_keepalive_idle = -1;
+        int m_tcp_keepalive_cnt = -1;
+        int m_tcp_keepalive_intvl = -1;
+        int m_immediate = -1;
+        // File descriptor of a socket already bound and listening on the
+        // end point of the channel, adopted instead of binding a new one,
+        // e.g. by kernels started from a pool of pre-warmed processes.
+        int m_use_fd = -1;
+    };
+
     struct XEUS_API xconfiguration
     {
         std::string m_transport;
@@ -26,6 +49,109 @@ namespace xeus
         std::string m_hb_port;
         std::string m_signature_scheme;
         std::string m_key;
+
+        // Consecutive stream messages with the same parent and stream name
+        // are merged on iopub during this window (in milliseconds), as long
+        // as the merged text does not exceed m_stream_batch_size bytes.
+        // A window of 0 disables batching.
+        long m_stream_batch_window = 0;
+        std::size_t m_stream_batch_size = 65536;
+
+        // Maximum time to wait for an input_reply on stdin, in milliseconds.
+        // Control requests are still served while waiting. A negative value
+        // waits until the reply arrives or the kernel is stopped.
+        long m_stdin_timeout = -1;
+
+        // Shell requests of these types share a single busy status when
+        // they arrive back to back, and their idle statuses are deferred
+        // until the shell queue is empty. Every request still gets its
+        // idle status, in the order the requests were received.
+        std::vector<std::string> m_status_coalescing;
+
+        // Queued shell requests of these types are handled before the
+        // other ones, which keep their relative order. After
+        // m_shell_priority_burst of them in a row, one of the other
+        // requests is handled if any is waiting. The list is empty by
+        // default, requests are then handled in the order they are
+        // received. Reordering is visible to front-ends, e.g. a
+        // comm_info_request may be answered before an earlier comm_open
+        // is handled. Control requests are always served by their own
+        // thread.
+        std::vector<std::string> m_shell_priority;
+        std::size_t m_shell_priority_burst = 8;
+
+        // Published messages are serialized and signed by the iopub thread,
+        // at most m_publish_queue_size of them wait in its queue. When the
+        // queue is full, m_publish_policy tells what the publishing thread
+        // does: "block", "drop_oldest_stream" or "coalesce" (see
+        // publish_policy).
+        std::size_t m_publish_queue_size = 1024;
+        std::string m_publish_policy = "block";
+
+        // When not empty, the last m_iopub_replay_size messages published
+        // on iopub, within m_iopub_replay_bytes bytes, and the last status
+        // are served on this port of m_ip, so that a client connecting
+        // late or reconnecting can catch up (see xpublisher).
+        std::string m_iopub_replay_port;
+        std::size_t m_iopub_replay_size = 256;
+        std::size_t m_iopub_replay_bytes = 16 * 1024 * 1024;
+
+        // When set to "zstd" or "lz4", the contents of display_data,
+        // execute_result and update_display_data messages of at least
+        // m_iopub_compression_threshold bytes are compressed, and the codec
+        // is set in their metadata. Front-ends must be able to decompress
+        // them, the codec is also declared in the kernel_info_reply. The
+        // codecs available depend on the XEUS_ENABLE_COMPRESSION build
+        // option.
+        std::string m_iopub_compression;
+        int m_iopub_compression_level = 1;
+        std::size_t m_iopub_compression_threshold = 64 * 1024;
+
+        // Read from the optional "socket_options" object, which holds the
+        // number of ZeroMQ I/O threads ("io_threads"), the CPUs they are
+        // bound to ("io_thread_affinity", requires ZeroMQ 4.3) and one
+        // object of options per channel ("shell", "control", "stdin",
+        // "iopub" and "hb").
+        int m_io_threads = 1;
+        std::vector<int> m_io_thread_affinity;
+        xsocket_options m_shell_options;
+        xsocket_options m_control_options;
+        xsocket_options m_stdin_options;
+        xsocket_options m_iopub_options;
+        xsocket_options m_hb_options;
+
+        // The heartbeat is served by the thread serving iopub, unless
+        // it has its own thread, which keeps heartbeat latency low
+        // while large messages are serialized.
+        bool m_dedicated_heartbeat = false;
+
+        // A shutdown_request asking for a restart restarts the kernel in
+        // the same process, keeping its sockets bound, when the kernel
+        // has an interpreter builder (see xkernel) and its server supports
+        // restarts (see xserver::restart). The front-end must not wait for
+        // the process to exit.
+        bool m_restart_in_process = false;
+
+        // The interpreter is configured on a background thread while the
+        // kernel already publishes its starting status and answers
+        // heartbeats and kernel_info_requests. Other shell requests wait
+        // until the configuration is done. kernel_info_request and the
+        // control requests of the interpreter must then not depend on
+        // configure_impl.
+        bool m_background_configure = false;
+
+        // When not empty, the metrics (see xmetrics_snapshot) are served
+        // over HTTP on this TCP port of m_ip, in the Prometheus text
+        // format. They are empty unless xeus is built with
+        // XEUS_ENABLE_METRICS.
+        std::string m_metrics_port;
+
+        // Used by make_xserver_shm: binary buffers of at least
+        // m_shm_threshold bytes go through shared memory rings of
+        // m_shm_size bytes, named after m_shm_name (see xshm_transport).
+        std::string m_shm_name;
+        std::size_t m_shm_size = 256 * 1024 * 1024;
+        std::size_t m_shm_threshold = 64 * 1024;
     };
 
     XEUS_API
@@ -0,0 +1,65 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XKERNEL_HOST_HPP
+#define XKERNEL_HOST_HPP
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "zmq.hpp"
+
+#include "xeus.hpp"
+#include "xkernel.hpp"
+
+namespace xeus
+{
+
+    class xserver_pump;
+
+    /**
+     * @class xkernel_host
+     * @brief Runs several kernels in the same process.
+     *
+     * The kernels share a ZeroMQ context and its I/O threads, and a
+     * single thread serves the iopub and heartbeat channels of all of
+     * them. Each kernel keeps a thread for its shell and stdin channels
+     * and one for its control channel. The server builder of the hosted
+     * kernels and the context options of their configurations are not
+     * used.
+     */
+    class XEUS_API xkernel_host
+    {
+    public:
+
+        explicit xkernel_host(int io_threads = 1);
+        // Waits for the started kernels to be stopped
+        ~xkernel_host();
+
+        xkernel_host(const xkernel_host&) = delete;
+        xkernel_host& operator=(const xkernel_host&) = delete;
+
+        xkernel_host(xkernel_host&&) = delete;
+        xkernel_host& operator=(xkernel_host&&) = delete;
+
+        // Starts kernel on a new thread and returns. The kernel
+        // must not be destroyed before it is stopped.
+        void start(xkernel& kernel);
+        void join();
+
+    private:
+
+        zmq::context_t m_context;
+        std::unique_ptr<xserver_pump> p_pump;
+        std::vector<std::thread> m_kernel_threads;
+    };
+
+}
+
+#endif
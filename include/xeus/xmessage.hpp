@@ -9,20 +9,71 @@
 #ifndef XMESSAGE_HPP
 #define XMESSAGE_HPP
 
+#include <cstddef>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "xauthentication.hpp"
 #include "xeus.hpp"
 #include "xjson.hpp"
+#include "xsmall_vector.hpp"
 #include "zmq_addon.hpp"
 
 namespace xeus
 {
 
+    /**
+     * @class xjson_frame
+     * @brief JSON part of a message, held as a document or as a raw frame.
+     *
+     * A part built from a frame received on the wire is parsed on first
+     * access only. Copies share the underlying frame instead of copying
+     * the document, and serializing such a part reuses the raw bytes.
+     * Accessing a part is not thread-safe.
+     */
+    class XEUS_API xjson_frame
+    {
+    public:
+
+        xjson_frame();
+        xjson_frame(xjson value);
+        explicit xjson_frame(zmq::message_t frame);
+
+        ~xjson_frame() = default;
+
+        xjson_frame(const xjson_frame&);
+        xjson_frame& operator=(const xjson_frame&);
+
+        xjson_frame(xjson_frame&&) = default;
+        xjson_frame& operator=(xjson_frame&&) = default;
+
+        const xjson& get() const;
+        // Returns the document to modify it in place. A raw frame is
+        // parsed and dropped, serialize then writes the document.
+        xjson& get_mutable();
+
+        bool has_frame() const noexcept;
+        const zmq::message_t& frame() const noexcept;
+
+        zmq::message_t serialize() const;
+
+    private:
+
+        mutable xjson m_value;
+        zmq::message_t m_frame;
+        mutable bool m_parsed;
+        bool m_has_frame;
+    };
+
     class XEUS_API xmessage_base
     {
     public:
 
+        // Binary buffers sent as extra frames after the content. They are
+        // not signed, as specified by the Jupyter messaging protocol.
+        using buffer_sequence = std::vector<zmq::message_t>;
+
         xmessage_base(const xmessage_base&) = delete;
         xmessage_base& operator=(const xmessage_base&) = delete;
 
@@ -30,14 +81,31 @@ namespace xeus
         const xjson& parent_header() const;
         const xjson& metadata() const;
         const xjson& content() const;
+        const buffer_sequence& buffers() const;
+
+        const xjson_frame& header_frame() const;
+        const xjson_frame& parent_header_frame() const;
+        const xjson_frame& metadata_frame() const;
+        const xjson_frame& content_frame() const;
+
+        // Content to modify in place, see xjson_frame::get_mutable
+        xjson& mutable_content();
+
+        // Returns the message type without parsing the whole header
+        std::string msg_type() const;
+
+        // Points data at the message type inside the raw header frame.
+        // Returns false when the header has to be parsed to get it.
+        bool raw_msg_type(const char*& data, std::size_t& size) const;
 
     protected:
 
         xmessage_base() = default;
-        xmessage_base(xjson header,
-                      xjson parent_header,
-                      xjson metadata,
-                      xjson content);
+        xmessage_base(xjson_frame header,
+                      xjson_frame parent_header,
+                      xjson_frame metadata,
+                      xjson_frame content,
+                      buffer_sequence buffers);
 
         ~xmessage_base() = default;
 
@@ -52,10 +120,11 @@ namespace xeus
 
     private:
 
-        xjson m_header;
-        xjson m_parent_header;
-        xjson m_metadata;
-        xjson m_content;
+        xjson_frame m_header;
+        xjson_frame m_parent_header;
+        xjson_frame m_metadata;
+        xjson_frame m_content;
+        buffer_sequence m_buffers;
     };
 
     class XEUS_API xmessage : public xmessage_base
@@ -63,14 +132,20 @@ namespace xeus
 
     public:
 
-        using guid_list = std::vector<std::string>;
+        // A request usually has a single identity, which is short
+        // enough to be stored without allocation by std::string.
+        // Before xeus 0.12, guid_list was std::vector<std::string>:
+        // xsmall_vector converts to it, but code taking it by non-const
+        // reference or calling other vector members must be updated.
+        using guid_list = xsmall_vector<std::string, 2>;
 
         xmessage() = default;
         xmessage(const guid_list& zmq_id,
-                 xjson header,
-                 xjson parent_header,
-                 xjson metadata,
-                 xjson content);
+                 xjson_frame header,
+                 xjson_frame parent_header,
+                 xjson_frame metadata,
+                 xjson_frame content,
+                 buffer_sequence buffers = buffer_sequence());
 
         ~xmessage() = default;
 
@@ -97,10 +172,11 @@ namespace xeus
 
         xpub_message() = default;
         xpub_message(const std::string& topic,
-                     xjson header,
-                     xjson parent_header,
-                     xjson metadata,
-                     xjson content);
+                     xjson_frame header,
+                     xjson_frame parent_header,
+                     xjson_frame metadata,
+                     xjson_frame content,
+                     buffer_sequence buffers = buffer_sequence());
 
         ~xpub_message() = default;
 
@@ -120,6 +196,16 @@ namespace xeus
         std::string m_topic;
     };
 
+    /**
+     * Builds a buffer frame referencing data without copying it. data must
+     * remain valid as long as owner is alive; the frame keeps a reference
+     * on owner until ZeroMQ has sent every copy of it.
+     */
+    XEUS_API
+    zmq::message_t make_buffer(const void* data,
+                               std::size_t size,
+                               std::shared_ptr<const void> owner);
+
     XEUS_API
     std::string iso8601_now();
 
@@ -0,0 +1,65 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XMETRICS_HPP
+#define XMETRICS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xeus.hpp"
+
+namespace xeus
+{
+
+    struct XEUS_API xhistogram_snapshot
+    {
+        // Upper bound (exclusive, in nanoseconds) and count of the
+        // non-empty buckets, in increasing order. Buckets are log-linear,
+        // the relative error on a recorded value is at most 12.5%.
+        using bucket_list = std::vector<std::pair<std::uint64_t, std::uint64_t>>;
+
+        std::uint64_t m_count = 0;
+        std::uint64_t m_sum = 0;
+        bucket_list m_buckets;
+
+        // Upper bound of the bucket holding the given percentile
+        // (between 0 and 100), 0 if nothing has been recorded.
+        std::uint64_t percentile(double p) const;
+    };
+
+    /**
+     * Metrics collected by every kernel of the process since it started.
+     * They are only collected when xeus is built with XEUS_ENABLE_METRICS,
+     * m_enabled is false otherwise and the other members are empty.
+     */
+    struct XEUS_API xmetrics_snapshot
+    {
+        bool m_enabled = false;
+        // Requests handled, per message type
+        std::map<std::string, std::uint64_t> m_requests;
+        // deserialize, handler, serialize, send, sign and verify. Stages
+        // overlap: verify is part of deserialize, and the signature computed
+        // while serializing is part of serialize.
+        std::map<std::string, xhistogram_snapshot> m_latencies;
+        // Current values, such as publish_queue_depth
+        std::map<std::string, std::int64_t> m_gauges;
+    };
+
+    XEUS_API
+    xmetrics_snapshot get_metrics();
+
+    // Prometheus text exposition format (version 0.0.4)
+    XEUS_API
+    std::string format_prometheus(const xmetrics_snapshot& metrics);
+}
+
+#endif
@@ -11,9 +11,12 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "xeus.hpp"
 #include "xkernel_configuration.hpp"
+#include "xmessage.hpp"
 #include "zmq.hpp"
 #include "zmq_addon.hpp"
 
@@ -25,6 +28,7 @@ namespace xeus
     public:
 
         using listener = std::function<void(zmq::multipart_t&)>;
+        using idle_listener = std::function<void()>;
 
         virtual ~xserver() = default;
 
@@ -38,14 +42,49 @@ namespace xeus
         void send_control(zmq::multipart_t& message);
         void send_stdin(zmq::multipart_t& message);
         void publish(zmq::multipart_t& message);
+        // The message is serialized and signed by the server, which
+        // may do it asynchronously. Safe to call from any thread.
+        void publish(xpub_message message);
+
+        // Receives a request already queued on the shell channel, without
+        // waiting. Returns false if there is none. Must be called from
+        // the thread serving the shell channel.
+        bool poll_shell(zmq::multipart_t& message);
 
         void start(zmq::multipart_t& message);
-        void abort_queue(const listener& l, long polling_interval);
+        // Passes the requests queued on the shell channel to l, then
+        // those received within grace_period milliseconds.
+        void abort_queue(const listener& l, long grace_period);
         void stop();
+        // Makes start return and keeps the channels open, start
+        // may then be called again (see xkernel). Servers which do not
+        // override restart_impl ignore it, m_restart_in_process must
+        // then be false.
+        void restart();
+
+        // While the shell channel is held, only the requests of the
+        // allowed types are passed to the shell listener, the other ones
+        // are queued until release_shell is called. hold_shell must be
+        // called before start or from the shell thread, release_shell
+        // is safe to call from any thread. abort_queue also aborts the
+        // held requests; when the server stops, they are dropped, like
+        // the requests still queued in the shell socket. Servers which do
+        // not override them pass every request to the shell listener.
+        void hold_shell(const std::vector<std::string>& allowed_types);
+        void release_shell();
+
+        // Replaces the ports of config with the ones the channels are
+        // bound to, e.g. the ports picked by the system for channels
+        // bound to port 0. Must be called before start. Servers which
+        // do not override update_ports_impl leave config unchanged.
+        void update_ports(xconfiguration& config) const;
 
         void register_shell_listener(const listener& l);
         void register_control_listener(const listener& l);
         void register_stdin_listener(const listener& l);
+        // Called on the shell thread when no request is queued
+        // on the shell channel after one has been handled.
+        void register_idle_listener(const idle_listener& l);
 
     protected:
 
@@ -54,6 +93,7 @@ namespace xeus
         void notify_shell_listener(zmq::multipart_t& message);
         void notify_control_listener(zmq::multipart_t& message);
         void notify_stdin_listener(zmq::multipart_t& message);
+        void notify_idle_listener();
 
     private:
 
@@ -61,19 +101,33 @@ namespace xeus
         virtual void send_control_impl(zmq::multipart_t& message) = 0;
         virtual void send_stdin_impl(zmq::multipart_t& message) = 0;
         virtual void publish_impl(zmq::multipart_t& message) = 0;
+        virtual void publish_message_impl(xpub_message message) = 0;
+        virtual bool poll_shell_impl(zmq::multipart_t& message) = 0;
 
         virtual void start_impl(zmq::multipart_t& message) = 0;
-        virtual void abort_queue_impl(const listener& l, long polling_interval) = 0;
+        virtual void abort_queue_impl(const listener& l, long grace_period) = 0;
+        virtual void hold_shell_impl(const std::vector<std::string>& allowed_types);
+        virtual void release_shell_impl();
+        virtual void update_ports_impl(xconfiguration& config) const;
         virtual void stop_impl() = 0;
+        virtual void restart_impl();
 
         listener m_shell_listener;
         listener m_control_listener;
         listener m_stdin_listener;
+        idle_listener m_idle_listener;
     };
 
     XEUS_API
     std::unique_ptr<xserver> make_xserver(zmq::context_t& context,
                                           const xconfiguration& config);
+
+    // Server for front-ends running on the same host: large binary
+    // buffers are exchanged through shared memory, and only their
+    // descriptors are sent on the sockets. Requires the ipc transport.
+    XEUS_API
+    std::unique_ptr<xserver> make_xserver_shm(zmq::context_t& context,
+                                              const xconfiguration& config);
 }
 
 #endif
@@ -0,0 +1,317 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XSMALL_VECTOR_HPP
+#define XSMALL_VECTOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace xeus
+{
+
+    /**
+     * @class xsmall_vector
+     * @brief Sequence holding up to N elements without allocating.
+     *
+     * Elements are stored inline until the (N + 1)th one is added, they are
+     * then moved to a std::vector. Elements are contiguous in both cases.
+     * Only the operations needed by xeus are provided.
+     */
+    template <class T, std::size_t N>
+    class xsmall_vector
+    {
+    public:
+
+        using value_type = T;
+        using size_type = std::size_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        xsmall_vector() noexcept;
+        ~xsmall_vector();
+
+        xsmall_vector(const xsmall_vector& rhs);
+        xsmall_vector& operator=(const xsmall_vector& rhs);
+
+        xsmall_vector(xsmall_vector&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value);
+        xsmall_vector& operator=(xsmall_vector&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value);
+
+        size_type size() const noexcept;
+        bool empty() const noexcept;
+
+        reference operator[](size_type i) noexcept;
+        const_reference operator[](size_type i) const noexcept;
+
+        iterator begin() noexcept;
+        iterator end() noexcept;
+        const_iterator begin() const noexcept;
+        const_iterator end() const noexcept;
+        const_iterator cbegin() const noexcept;
+        const_iterator cend() const noexcept;
+
+        // Eases the migration of code written against std::vector
+        operator std::vector<T>() const;
+
+        void push_back(const T& value);
+        void push_back(T&& value);
+
+        template <class... Args>
+        reference emplace_back(Args&&... args);
+
+        void clear() noexcept;
+
+    private:
+
+        using storage_type = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+        T* inline_data() noexcept;
+        const T* inline_data() const noexcept;
+
+        void assign(const xsmall_vector& rhs);
+        void steal(xsmall_vector& rhs);
+
+        storage_type m_storage[N];
+        size_type m_size;
+        bool m_inline;
+        std::vector<T> m_heap;
+    };
+
+    /********************************
+     * xsmall_vector implementation *
+     ********************************/
+
+    template <class T, std::size_t N>
+    inline xsmall_vector<T, N>::xsmall_vector() noexcept
+        : m_size(0), m_inline(true), m_heap()
+    {
+    }
+
+    template <class T, std::size_t N>
+    inline xsmall_vector<T, N>::~xsmall_vector()
+    {
+        clear();
+    }
+
+    template <class T, std::size_t N>
+    inline xsmall_vector<T, N>::xsmall_vector(const xsmall_vector& rhs)
+        : xsmall_vector()
+    {
+        assign(rhs);
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::operator=(const xsmall_vector& rhs) -> xsmall_vector&
+    {
+        if (this != &rhs)
+        {
+            clear();
+            assign(rhs);
+        }
+        return *this;
+    }
+
+    template <class T, std::size_t N>
+    inline xsmall_vector<T, N>::xsmall_vector(xsmall_vector&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : xsmall_vector()
+    {
+        steal(rhs);
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::operator=(xsmall_vector&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+        -> xsmall_vector&
+    {
+        if (this != &rhs)
+        {
+            clear();
+            steal(rhs);
+        }
+        return *this;
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::size() const noexcept -> size_type
+    {
+        return m_inline ? m_size : m_heap.size();
+    }
+
+    template <class T, std::size_t N>
+    inline bool xsmall_vector<T, N>::empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::operator[](size_type i) noexcept -> reference
+    {
+        return begin()[i];
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::operator[](size_type i) const noexcept -> const_reference
+    {
+        return begin()[i];
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::begin() noexcept -> iterator
+    {
+        return m_inline ? inline_data() : m_heap.data();
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::end() noexcept -> iterator
+    {
+        return begin() + size();
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::begin() const noexcept -> const_iterator
+    {
+        return m_inline ? inline_data() : m_heap.data();
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::end() const noexcept -> const_iterator
+    {
+        return begin() + size();
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::cbegin() const noexcept -> const_iterator
+    {
+        return begin();
+    }
+
+    template <class T, std::size_t N>
+    inline auto xsmall_vector<T, N>::cend() const noexcept -> const_iterator
+    {
+        return end();
+    }
+
+    template <class T, std::size_t N>
+    inline xsmall_vector<T, N>::operator std::vector<T>() const
+    {
+        return std::vector<T>(begin(), end());
+    }
+
+    template <class T, std::size_t N>
+    inline void xsmall_vector<T, N>::push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+
+    template <class T, std::size_t N>
+    inline void xsmall_vector<T, N>::push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template <class T, std::size_t N>
+    template <class... Args>
+    inline auto xsmall_vector<T, N>::emplace_back(Args&&... args) -> reference
+    {
+        if (!m_inline)
+        {
+            m_heap.emplace_back(std::forward<Args>(args)...);
+            return m_heap.back();
+        }
+
+        if (m_size < N)
+        {
+            T* res = new (inline_data() + m_size) T(std::forward<Args>(args)...);
+            ++m_size;
+            return *res;
+        }
+
+        // args may refer to an inline element, the new
+        // element is built before they are moved.
+        T value(std::forward<Args>(args)...);
+        m_heap.reserve(2 * N + 1);
+        for (size_type i = 0; i < m_size; ++i)
+        {
+            m_heap.push_back(std::move(inline_data()[i]));
+        }
+        m_heap.push_back(std::move(value));
+        for (size_type i = 0; i < m_size; ++i)
+        {
+            inline_data()[i].~T();
+        }
+        m_size = 0;
+        m_inline = false;
+        return m_heap.back();
+    }
+
+    template <class T, std::size_t N>
+    inline void xsmall_vector<T, N>::clear() noexcept
+    {
+        for (size_type i = 0; i < m_size; ++i)
+        {
+            inline_data()[i].~T();
+        }
+        m_size = 0;
+        m_heap.clear();
+        m_inline = true;
+    }
+
+    template <class T, std::size_t N>
+    inline T* xsmall_vector<T, N>::inline_data() noexcept
+    {
+        return reinterpret_cast<T*>(&m_storage[0]);
+    }
+
+    template <class T, std::size_t N>
+    inline const T* xsmall_vector<T, N>::inline_data() const noexcept
+    {
+        return reinterpret_cast<const T*>(&m_storage[0]);
+    }
+
+    template <class T, std::size_t N>
+    inline void xsmall_vector<T, N>::assign(const xsmall_vector& rhs)
+    {
+        if (rhs.m_inline)
+        {
+            for (const auto& value : rhs)
+            {
+                emplace_back(value);
+            }
+        }
+        else
+        {
+            m_heap = rhs.m_heap;
+            m_inline = false;
+        }
+    }
+
+    template <class T, std::size_t N>
+    inline void xsmall_vector<T, N>::steal(xsmall_vector& rhs)
+    {
+        if (rhs.m_inline)
+        {
+            for (size_type i = 0; i < rhs.m_size; ++i)
+            {
+                new (inline_data() + i) T(std::move(rhs.inline_data()[i]));
+            }
+            m_size = rhs.m_size;
+        }
+        else
+        {
+            m_heap = std::move(rhs.m_heap);
+            m_inline = false;
+        }
+        rhs.clear();
+    }
+}
+
+#endif
@@ -8,23 +8,71 @@
 
 #include <array>
 #include <cstddef>
+#include <map>
+#include <thread>
 #include "xeus/xauthentication.hpp"
 #include "xeus/make_unique.hpp"
+#include "xmac_pool.hpp"
+#include "xmetrics.hpp"
 #include "xstring_utils.hpp"
+#include "cryptopp/blake2.h"
 #include "cryptopp/sha.h"
 #include "cryptopp/hmac.h"
 
 namespace xeus
 {
 
-    template <class T>
+    template <class M>
+    class xsigner_impl : public xsigner
+    {
+
+    public:
+
+        using mac_type = M;
+        using signature_type = std::array<byte, mac_type::DIGESTSIZE>;
+        using handle_type = typename xmac_pool<mac_type>::handle;
+
+        explicit xsigner_impl(handle_type mac);
+        virtual ~xsigner_impl();
+
+    private:
+
+        void update_impl(const unsigned char* data, std::size_t size) override;
+        zmq::message_t final_impl() override;
+        bool verify_impl(const zmq::message_t& signature) override;
+
+        handle_type m_mac;
+        // A signer destroyed before final or verify, e.g. when the
+        // serialization of a later frame throws, restarts its context
+        // so that it goes back to the pool without the data fed so far.
+        bool m_finalized;
+    };
+
+    class no_xsigner : public xsigner
+    {
+
+    public:
+
+        no_xsigner() = default;
+        virtual ~no_xsigner() = default;
+
+    private:
+
+        void update_impl(const unsigned char* data, std::size_t size) override;
+        zmq::message_t final_impl() override;
+        bool verify_impl(const zmq::message_t& signature) override;
+    };
+
+    // M is the message authentication code, either an HMAC
+    // or a natively keyed hash function such as BLAKE2b.
+    template <class M>
     class xauthentication_impl : public xauthentication
     {
 
     public:
 
-        using hmac_type = CryptoPP::HMAC<T>;
-        using signature_type = std::array<byte, hmac_type::DIGESTSIZE>;
+        using mac_type = M;
+        using signature_type = std::array<byte, mac_type::DIGESTSIZE>;
 
         explicit xauthentication_impl(const std::string& key);
         virtual ~xauthentication_impl() = default;
@@ -42,9 +90,13 @@ namespace xeus
                          const zmq::message_t& meta_data,
                          const zmq::message_t& content) const override;
 
+        std::unique_ptr<xsigner> make_signer_impl() const override;
+
     private:
 
-        mutable hmac_type m_hmac;
+        // sign and verify may be called concurrently, each call
+        // acquires its own keyed context from the pool.
+        xmac_pool<mac_type> m_pool;
     };
 
     class no_xauthentication : public xauthentication
@@ -67,13 +119,36 @@ namespace xeus
                          const zmq::message_t& parent_header,
                          const zmq::message_t& meta_data,
                          const zmq::message_t& content) const override;
+
+        std::unique_ptr<xsigner> make_signer_impl() const override;
     };
 
+    void xsigner::update(const void* data, std::size_t size)
+    {
+        update_impl(static_cast<const unsigned char*>(data), size);
+    }
+
+    void xsigner::update(const zmq::message_t& frame)
+    {
+        update_impl(frame.data<const unsigned char>(), frame.size());
+    }
+
+    zmq::message_t xsigner::final()
+    {
+        return final_impl();
+    }
+
+    bool xsigner::verify(const zmq::message_t& signature)
+    {
+        return verify_impl(signature);
+    }
+
     zmq::message_t xauthentication::sign(const zmq::message_t& header,
                                          const zmq::message_t& parent_header,
                                          const zmq::message_t& meta_data,
                                          const zmq::message_t& content) const
     {
+        XEUS_METRICS_TIME(m_sign);
         return sign_impl(header, parent_header, meta_data, content);
     }
 
@@ -83,63 +158,141 @@ namespace xeus
                                  const zmq::message_t& meta_data,
                                  const zmq::message_t& content) const
     {
+        XEUS_METRICS_TIME(m_verify);
         return verify_impl(signature, header, parent_header, meta_data, content);
     }
 
-    const std::string sha256_scheme = "hmac-sha256";
+    std::unique_ptr<xsigner> xauthentication::make_signer() const
+    {
+        return make_signer_impl();
+    }
+
+    using authentication_builder = std::unique_ptr<xauthentication> (*)(const std::string&);
+
+    template <class M>
+    std::unique_ptr<xauthentication> build_xauthentication(const std::string& key)
+    {
+        return ::xeus::make_unique<xauthentication_impl<M>>(key);
+    }
+
+    // CryptoPP selects the SHA-NI / AVX2 / SSE implementations of the
+    // hash functions at runtime depending on the CPU features.
+    const std::map<std::string, authentication_builder>& get_authentication_schemes()
+    {
+        static const std::map<std::string, authentication_builder> schemes = {
+            { "hmac-sha256", &build_xauthentication<CryptoPP::HMAC<CryptoPP::SHA256>> },
+            { "hmac-sha512", &build_xauthentication<CryptoPP::HMAC<CryptoPP::SHA512>> },
+            // Keyed BLAKE2b (not an HMAC), keys are limited to 64 bytes.
+            // The front-end must support this scheme.
+            { "blake2b", &build_xauthentication<CryptoPP::BLAKE2b> }
+        };
+        return schemes;
+    }
 
     std::unique_ptr<xauthentication> make_xauthentication(const std::string& scheme,
                                                           const std::string& key)
     {
-        if (scheme == sha256_scheme)
+        const auto& schemes = get_authentication_schemes();
+        auto iter = schemes.find(scheme);
+        if (iter != schemes.end())
         {
-            return ::xeus::make_unique<xauthentication_impl<CryptoPP::SHA256>>(key);
+            return (iter->second)(key);
         }
         return ::xeus::make_unique<no_xauthentication>();
     }
 
-    template <class T>
-    xauthentication_impl<T>::xauthentication_impl(const std::string& key)
+    template <class M>
+    xauthentication_impl<M>::xauthentication_impl(const std::string& key)
+        : m_pool(key, std::thread::hardware_concurrency())
     {
-        m_hmac = hmac_type(reinterpret_cast<const byte*>(key.c_str()), key.size());
     }
 
-    template <class T>
-    zmq::message_t xauthentication_impl<T>::sign_impl(const zmq::message_t& header,
+    template <class M>
+    zmq::message_t xauthentication_impl<M>::sign_impl(const zmq::message_t& header,
                                                       const zmq::message_t& parent_header,
                                                       const zmq::message_t& meta_data,
                                                       const zmq::message_t& content) const
     {
-        m_hmac.Update(header.data<const unsigned char>(), header.size());
-        m_hmac.Update(parent_header.data<const unsigned char>(), parent_header.size());
-        m_hmac.Update(meta_data.data<const unsigned char>(), meta_data.size());
-        m_hmac.Update(content.data<const unsigned char>(), content.size());
-        signature_type sig;
-        m_hmac.Final(sig.data());
-        // Signature message must be the hexdigest, not the digest
-        std::string hex_sig = hex_string(sig);
-        return zmq::message_t(hex_sig.begin(), hex_sig.end());
+        xsigner_impl<M> signer(m_pool.acquire());
+        signer.update(header);
+        signer.update(parent_header);
+        signer.update(meta_data);
+        signer.update(content);
+        return signer.final();
     }
 
-    template <class T>
-    bool xauthentication_impl<T>::verify_impl(const zmq::message_t& signature,
+    template <class M>
+    bool xauthentication_impl<M>::verify_impl(const zmq::message_t& signature,
                                               const zmq::message_t& header,
                                               const zmq::message_t& parent_header,
                                               const zmq::message_t& meta_data,
                                               const zmq::message_t& content) const
     {
-        m_hmac.Update(header.data<const unsigned char>(), header.size());
-        m_hmac.Update(parent_header.data<const unsigned char>(), parent_header.size());
-        m_hmac.Update(meta_data.data<const unsigned char>(), meta_data.size());
-        m_hmac.Update(content.data<const unsigned char>(), content.size());
+        xsigner_impl<M> signer(m_pool.acquire());
+        signer.update(header);
+        signer.update(parent_header);
+        signer.update(meta_data);
+        signer.update(content);
+        return signer.verify(signature);
+    }
+
+    template <class M>
+    std::unique_ptr<xsigner> xauthentication_impl<M>::make_signer_impl() const
+    {
+        return ::xeus::make_unique<xsigner_impl<M>>(m_pool.acquire());
+    }
+
+    template <class M>
+    xsigner_impl<M>::xsigner_impl(handle_type mac)
+        : m_mac(std::move(mac)), m_finalized(false)
+    {
+    }
+
+    template <class M>
+    xsigner_impl<M>::~xsigner_impl()
+    {
+        if (!m_finalized)
+        {
+            m_mac->Restart();
+        }
+    }
+
+    template <class M>
+    void xsigner_impl<M>::update_impl(const unsigned char* data, std::size_t size)
+    {
+        m_mac->Update(data, size);
+    }
+
+    template <class M>
+    zmq::message_t xsigner_impl<M>::final_impl()
+    {
+        signature_type sig;
+        m_mac->Final(sig.data());
+        m_finalized = true;
+        // Signature message must be the hexdigest, not the digest
+        zmq::message_t res(2 * sig.size());
+        hex_encode(sig.data(), sig.size(), res.data<char>());
+        return res;
+    }
+
+    template <class M>
+    bool xsigner_impl<M>::verify_impl(const zmq::message_t& signature)
+    {
         signature_type sig;
-        m_hmac.Final(sig.data());
-        std::string hex_sig = hex_string(sig);
+        m_mac->Final(sig.data());
+        m_finalized = true;
+
+        // The received hexdigest is decoded once and compared
+        // to the computed digest.
+        signature_type received;
+        if (signature.size() != 2 * received.size() ||
+            !hex_decode(signature.data<const char>(), received.size(), received.data()))
+        {
+            return false;
+        }
 
         // Reduces the vulnerability to timing attacks.
-        bool res = CryptoPP::VerifyBufsEqual(reinterpret_cast<const byte*>(hex_sig.c_str()),
-                                             signature.data<const unsigned char>(),
-                                             hex_sig.size());
+        bool res = CryptoPP::VerifyBufsEqual(sig.data(), received.data(), sig.size());
         return res;
     }
 
@@ -160,4 +313,23 @@ namespace xeus
         return true;
     }
 
+    std::unique_ptr<xsigner> no_xauthentication::make_signer_impl() const
+    {
+        return ::xeus::make_unique<no_xsigner>();
+    }
+
+    void no_xsigner::update_impl(const unsigned char* /*data*/, std::size_t /*size*/)
+    {
+    }
+
+    zmq::message_t no_xsigner::final_impl()
+    {
+        return zmq::message_t(0);
+    }
+
+    bool no_xsigner::verify_impl(const zmq::message_t& /*signature*/)
+    {
+        return true;
+    }
+
 }
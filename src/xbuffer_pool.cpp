@@ -0,0 +1,59 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <utility>
+
+#include "xbuffer_pool.hpp"
+
+namespace xeus
+{
+
+    xbuffer_pool::xbuffer_pool(std::size_t max_size, std::size_t max_capacity)
+        : m_max_size(max_size),
+          m_max_capacity(max_capacity)
+    {
+        m_buffers.reserve(max_size);
+    }
+
+    auto xbuffer_pool::acquire() -> buffer_ptr
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_buffers.empty())
+            {
+                buffer_ptr res = std::move(m_buffers.back());
+                m_buffers.pop_back();
+                return res;
+            }
+        }
+        return buffer_ptr(new std::string());
+    }
+
+    void xbuffer_pool::release(buffer_ptr buffer) noexcept
+    {
+        if (buffer->capacity() > m_max_capacity)
+        {
+            return;
+        }
+        buffer->clear();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_buffers.size() < m_max_size)
+        {
+            m_buffers.push_back(std::move(buffer));
+        }
+    }
+
+    xbuffer_pool& get_serialization_pool()
+    {
+        // Never destroyed: ZeroMQ may release frames while
+        // static objects are destroyed at exit.
+        static xbuffer_pool* pool = new xbuffer_pool(256, 1024 * 1024);
+        return *pool;
+    }
+
+}
@@ -0,0 +1,59 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XBUFFER_POOL_HPP
+#define XBUFFER_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xeus
+{
+
+    /**
+     * @class xbuffer_pool
+     * @brief Recycles the buffers messages are serialized into.
+     *
+     * Serialized frames are handed to ZeroMQ, which releases them from its
+     * I/O threads once they are sent; acquire and release may therefore be
+     * called from any thread. Released buffers keep their capacity, so that
+     * serializing a message usually neither allocates nor reallocates.
+     * Buffers larger than max_capacity are freed instead of being kept.
+     */
+    class xbuffer_pool
+    {
+    public:
+
+        using buffer_ptr = std::unique_ptr<std::string>;
+
+        xbuffer_pool(std::size_t max_size, std::size_t max_capacity);
+
+        xbuffer_pool(const xbuffer_pool&) = delete;
+        xbuffer_pool& operator=(const xbuffer_pool&) = delete;
+
+        // The returned buffer is empty
+        buffer_ptr acquire();
+        void release(buffer_ptr buffer) noexcept;
+
+    private:
+
+        std::size_t m_max_size;
+        std::size_t m_max_capacity;
+        std::mutex m_mutex;
+        std::vector<buffer_ptr> m_buffers;
+    };
+
+    // Pool used by xjson_frame::serialize
+    xbuffer_pool& get_serialization_pool();
+
+}
+
+#endif
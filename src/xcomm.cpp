@@ -1,19 +1,212 @@
+#include <cstring>
+
 #include "xeus/xcomm.hpp"
 #include "xkernel_core.hpp"
 
 namespace xeus
 {
-    void xtarget::publish_message(const std::string& msg_type, xjson metadata, xjson content) const
+    namespace
+    {
+        constexpr std::uint32_t empty_slot = 0xFFFFFFFF;
+        constexpr std::size_t initial_slot_count = 16;
+        constexpr std::size_t hex_id_size = 32;
+
+        // Accepts lower case digits only, so that two ids with the
+        // same value are always the same string.
+        bool parse_hex_id(const char* id, std::size_t size, std::uint64_t& high, std::uint64_t& low)
+        {
+            if (size != hex_id_size)
+            {
+                return false;
+            }
+            std::uint64_t half[2] = { 0, 0 };
+            for (std::size_t i = 0; i < hex_id_size; ++i)
+            {
+                char c = id[i];
+                std::uint64_t digit;
+                if (c >= '0' && c <= '9')
+                {
+                    digit = static_cast<std::uint64_t>(c - '0');
+                }
+                else if (c >= 'a' && c <= 'f')
+                {
+                    digit = static_cast<std::uint64_t>(c - 'a' + 10);
+                }
+                else
+                {
+                    return false;
+                }
+                std::uint64_t& h = half[i / 16];
+                h = (h << 4) | digit;
+            }
+            high = half[0];
+            low = half[1];
+            return true;
+        }
+
+        std::uint64_t fnv1a(const char* id, std::size_t size, std::uint64_t h)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                h ^= static_cast<unsigned char>(id[i]);
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+    }
+
+    xcomm_map::xcomm_map()
+        : m_values(), m_keys(), m_slots(initial_slot_count, empty_slot)
+    {
+    }
+
+    xcomm* xcomm_map::find(const char* id, size_type size) const
+    {
+        key_type key = make_key(id, size);
+        std::uint32_t index = m_slots[probe(key, id, size)];
+        return index == empty_slot ? nullptr : m_values[index].second;
+    }
+
+    void xcomm_map::insert(const xguid& id, xcomm* comm)
+    {
+        key_type key = make_key(id.c_str(), id.size());
+        size_type slot = probe(key, id.c_str(), id.size());
+        if (m_slots[slot] != empty_slot)
+        {
+            m_values[m_slots[slot]].second = comm;
+            return;
+        }
+
+        if (2 * (m_values.size() + 1) > m_slots.size())
+        {
+            grow();
+            slot = probe(key, id.c_str(), id.size());
+        }
+        m_slots[slot] = static_cast<std::uint32_t>(m_values.size());
+        m_values.emplace_back(id, comm);
+        m_keys.push_back(key);
+    }
+
+    void xcomm_map::erase(const char* id, size_type size)
+    {
+        key_type key = make_key(id, size);
+        size_type slot = probe(key, id, size);
+        std::uint32_t index = m_slots[slot];
+        if (index == empty_slot)
+        {
+            return;
+        }
+
+        // Backward shift deletion, so that lookups never
+        // have to skip over removed entries.
+        size_type mask = m_slots.size() - 1;
+        size_type hole = slot;
+        size_type next = (hole + 1) & mask;
+        while (m_slots[next] != empty_slot)
+        {
+            size_type home = hash(m_keys[m_slots[next]]) & mask;
+            // Moves the entry if its home is not in (hole, next]
+            bool in_range = hole <= next ? (hole < home && home <= next)
+                                         : (hole < home || home <= next);
+            if (!in_range)
+            {
+                m_slots[hole] = m_slots[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        m_slots[hole] = empty_slot;
+
+        // The last comm takes the place of the removed one
+        std::uint32_t last = static_cast<std::uint32_t>(m_values.size() - 1);
+        if (index != last)
+        {
+            const value_type& moved = m_values[last];
+            size_type moved_slot = probe(m_keys[last], moved.first.c_str(), moved.first.size());
+            m_slots[moved_slot] = index;
+            m_values[index] = std::move(m_values[last]);
+            m_keys[index] = m_keys[last];
+        }
+        m_values.pop_back();
+        m_keys.pop_back();
+    }
+
+    auto xcomm_map::make_key(const char* id, size_type size) -> key_type
+    {
+        key_type key;
+        key.m_hex = parse_hex_id(id, size, key.m_high, key.m_low);
+        if (!key.m_hex)
+        {
+            key.m_high = fnv1a(id, size, 14695981039346656037ull);
+            key.m_low = fnv1a(id, size, 0x6A09E667F3BCC908ull);
+        }
+        return key;
+    }
+
+    auto xcomm_map::hash(const key_type& key) -> size_type
+    {
+        // Generated ids are random, mixing both halves is enough
+        std::uint64_t h = (key.m_high ^ key.m_low) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_type>(h >> 32);
+    }
+
+    bool xcomm_map::matches(std::uint32_t index, const key_type& key, const char* id, size_type size) const
+    {
+        const key_type& other = m_keys[index];
+        if (other.m_high != key.m_high || other.m_low != key.m_low || other.m_hex != key.m_hex)
+        {
+            return false;
+        }
+        if (key.m_hex)
+        {
+            return true;
+        }
+        const xguid& other_id = m_values[index].first;
+        return other_id.size() == size && std::memcmp(other_id.c_str(), id, size) == 0;
+    }
+
+    // Returns the slot holding the id, or the empty slot
+    // where it should be inserted.
+    auto xcomm_map::probe(const key_type& key, const char* id, size_type size) const -> size_type
+    {
+        size_type mask = m_slots.size() - 1;
+        size_type slot = hash(key) & mask;
+        while (m_slots[slot] != empty_slot && !matches(m_slots[slot], key, id, size))
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void xcomm_map::grow()
+    {
+        std::vector<std::uint32_t> slots(2 * m_slots.size(), empty_slot);
+        size_type mask = slots.size() - 1;
+        for (std::uint32_t i = 0; i < m_keys.size(); ++i)
+        {
+            size_type slot = hash(m_keys[i]) & mask;
+            while (slots[slot] != empty_slot)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = i;
+        }
+        m_slots.swap(slots);
+    }
+
+    void xtarget::publish_message(const std::string& msg_type, xjson metadata, xjson content,
+                                  buffer_sequence buffers) const
     {
         if (p_manager->p_kernel != nullptr)
         {
-            p_manager->p_kernel->publish_message(msg_type, std::move(metadata), std::move(content));
+            p_manager->p_kernel->publish_message(msg_type, std::move(metadata), std::move(content),
+                                                 std::move(buffers));
         }
     }
 
     xcomm_manager::xcomm_manager(xkernel_core* kernel)
+        : p_kernel(kernel), m_message_coalescing(false)
     {
-        p_kernel = kernel;
     }
 
     xjson xcomm_manager::get_metadata() const
@@ -36,7 +229,7 @@ namespace xeus
 
     void xcomm_manager::register_comm(xguid id, xcomm* comm)
     {
-        m_comms[id] = comm;
+        m_comms.insert(id, comm);
     }
 
     void xcomm_manager::unregister_comm(xguid id)
@@ -66,31 +259,51 @@ namespace xeus
     void xcomm_manager::comm_close(const xmessage& request)
     {
         const xjson& content = request.content();
-        xguid id = content["comm_id"];
-        auto position = m_comms.find(id);
-        if (position == m_comms.end())
+        // The id is looked up in place, without being copied
+        const std::string& id = content["comm_id"].get_ref<const std::string&>();
+        xcomm* comm = m_comms.find(id.c_str(), id.size());
+        if (comm == nullptr)
         {
             throw std::runtime_error("No such comm registered: " + id);
         }
         else
         {
-            position->second->handle_close(request);
+            comm->handle_close(request);
         }
-        m_comms.erase(id);
+        m_comms.erase(id.c_str(), id.size());
     }
 
     void xcomm_manager::comm_msg(const xmessage& request)
     {
         const xjson& content = request.content();
-        xguid id = content["comm_id"];
-        auto position = m_comms.find(id);
-        if (position == m_comms.end())
+        const std::string& id = content["comm_id"].get_ref<const std::string&>();
+        xcomm* comm = m_comms.find(id.c_str(), id.size());
+        if (comm == nullptr)
+        {
+            throw std::runtime_error("No such comm registered: " + id);
+        }
+        else
+        {
+            comm->handle_message(request);
+        }
+    }
+
+    void xcomm_manager::comm_msg_batch(const std::vector<xmessage>& requests)
+    {
+        if (requests.empty())
+        {
+            return;
+        }
+        const xjson& content = requests.front().content();
+        const std::string& id = content["comm_id"].get_ref<const std::string&>();
+        xcomm* comm = m_comms.find(id.c_str(), id.size());
+        if (comm == nullptr)
         {
             throw std::runtime_error("No such comm registered: " + id);
         }
         else
         {
-            position->second->handle_message(request);
+            comm->handle_message_batch(requests);
         }
     }
 }
@@ -0,0 +1,230 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#ifdef XEUS_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef XEUS_WITH_LZ4
+#include <lz4frame.h>
+#endif
+
+#include "xbuffer_pool.hpp"
+#include "xcompression.hpp"
+#include "xmessage_utils.hpp"
+#include "xmetrics.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const std::string delimiter = "<IDS|MSG>";
+
+        const char* const compressed_types[] = {
+            "display_data",
+            "execute_result",
+            "update_display_data"
+        };
+
+        // Compresses size bytes of data into out, which is resized to
+        // the compressed size. Returns false if the codec failed.
+        bool compress_buffer(const std::string& codec,
+                             int level,
+                             const char* data,
+                             std::size_t size,
+                             std::string& out)
+        {
+#ifdef XEUS_WITH_ZSTD
+            if (codec == "zstd")
+            {
+                out.resize(ZSTD_compressBound(size));
+                std::size_t res = ZSTD_compress(&out[0], out.size(), data, size, level);
+                if (ZSTD_isError(res))
+                {
+                    return false;
+                }
+                out.resize(res);
+                return true;
+            }
+#endif
+#ifdef XEUS_WITH_LZ4
+            if (codec == "lz4")
+            {
+                // The frame format stores the content size, so that the
+                // receiver can allocate the output once.
+                LZ4F_preferences_t preferences;
+                std::memset(&preferences, 0, sizeof(preferences));
+                preferences.compressionLevel = level;
+                preferences.frameInfo.contentSize = size;
+                out.resize(LZ4F_compressFrameBound(size, &preferences));
+                std::size_t res = LZ4F_compressFrame(&out[0], out.size(), data, size, &preferences);
+                if (LZ4F_isError(res))
+                {
+                    return false;
+                }
+                out.resize(res);
+                return true;
+            }
+#endif
+            (void)codec;
+            (void)level;
+            (void)data;
+            (void)size;
+            (void)out;
+            return false;
+        }
+    }
+
+    bool compression_available(const std::string& codec)
+    {
+#ifdef XEUS_WITH_ZSTD
+        if (codec == "zstd")
+        {
+            return true;
+        }
+#endif
+#ifdef XEUS_WITH_LZ4
+        if (codec == "lz4")
+        {
+            return true;
+        }
+#endif
+        (void)codec;
+        return false;
+    }
+
+    xjson compression_info(const std::string& codec, std::size_t threshold)
+    {
+        xjson res;
+        if (compression_available(codec))
+        {
+            res["codec"] = codec;
+            res["threshold"] = threshold;
+        }
+        return res;
+    }
+
+    xcompressor::xcompressor(const std::string& codec, int level, std::size_t threshold)
+        : m_codec(codec),
+          m_level(level),
+          m_threshold(threshold)
+    {
+        if (!m_codec.empty() && !compression_available(m_codec))
+        {
+            std::cerr << "ERROR: compression codec " << m_codec << " is not available, "
+                      << "iopub contents are not compressed" << std::endl;
+            m_codec.clear();
+        }
+    }
+
+    bool xcompressor::enabled() const noexcept
+    {
+        return !m_codec.empty();
+    }
+
+    bool xcompressor::accepts(const xpub_message& message) const
+    {
+        if (!enabled())
+        {
+            return false;
+        }
+
+        const char* type_data;
+        std::size_t type_size;
+        std::string msg_type;
+        if (!message.raw_msg_type(type_data, type_size))
+        {
+            msg_type = message.msg_type();
+            type_data = msg_type.c_str();
+            type_size = msg_type.size();
+        }
+        for (const char* type : compressed_types)
+        {
+            if (std::strlen(type) == type_size && std::memcmp(type, type_data, type_size) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void xcompressor::serialize(const xpub_message& message,
+                                zmq::multipart_t& wire_msg,
+                                const xauthentication& auth) const
+    {
+        XEUS_METRICS_TIME(m_serialize);
+        zmq::message_t header = message.header_frame().serialize();
+        zmq::message_t parent_header = message.parent_header_frame().serialize();
+        zmq::message_t content = message.content_frame().serialize();
+        zmq::message_t metadata;
+
+        zmq::message_t compressed;
+        if (compress(content, compressed))
+        {
+            xjson metadata_value = message.metadata();
+            metadata_value["compression"] = m_codec;
+            metadata = xjson_frame(std::move(metadata_value)).serialize();
+            content = std::move(compressed);
+        }
+        else
+        {
+            metadata = message.metadata_frame().serialize();
+        }
+
+        std::unique_ptr<xsigner> signer = auth.make_signer();
+        signer->update(header);
+        signer->update(parent_header);
+        signer->update(metadata);
+        signer->update(content);
+
+        const std::string& topic = message.topic();
+        wire_msg.add(zmq::message_t(topic.begin(), topic.end()));
+        wire_msg.add(zmq::message_t(delimiter.begin(), delimiter.end()));
+        wire_msg.add(signer->final());
+        wire_msg.add(std::move(header));
+        wire_msg.add(std::move(parent_header));
+        wire_msg.add(std::move(metadata));
+        wire_msg.add(std::move(content));
+
+        // Buffers are shared with the message, not copied
+        for (const auto& buffer : message.buffers())
+        {
+            zmq::message_t frame;
+            frame.copy(&buffer);
+            wire_msg.add(std::move(frame));
+        }
+    }
+
+    bool xcompressor::compress(const zmq::message_t& frame, zmq::message_t& res) const
+    {
+        if (frame.size() < m_threshold)
+        {
+            return false;
+        }
+
+        xbuffer_pool& pool = get_serialization_pool();
+        xbuffer_pool::buffer_ptr buffer = pool.acquire();
+        if (!compress_buffer(m_codec, m_level, frame.data<const char>(), frame.size(), *buffer) ||
+            buffer->size() >= frame.size())
+        {
+            pool.release(std::move(buffer));
+            return false;
+        }
+
+        // As in write_zmq_message, ZeroMQ gives the buffer back to the pool
+        res = zmq::message_t(&(*buffer)[0], buffer->size(), release_zmq_buffer, buffer.get());
+        buffer.release();
+        return true;
+    }
+
+}
@@ -0,0 +1,70 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XCOMPRESSION_HPP
+#define XCOMPRESSION_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+#include "xeus/xauthentication.hpp"
+#include "xeus/xjson.hpp"
+#include "xeus/xmessage.hpp"
+
+namespace xeus
+{
+
+    // Returns true if xeus was built with the codec, "zstd" or "lz4"
+    bool compression_available(const std::string& codec);
+
+    // Description of the compression of iopub contents added to the
+    // kernel_info_reply, null when the codec is not available.
+    xjson compression_info(const std::string& codec, std::size_t threshold);
+
+    /**
+     * @class xcompressor
+     * @brief Compresses the content of large display messages.
+     *
+     * The content frame of display_data, execute_result and
+     * update_display_data messages of at least threshold bytes is replaced
+     * with a zstd or LZ4 frame, and the codec is set as the "compression"
+     * field of the metadata. The signature is computed over the
+     * compressed bytes. Contents that do not shrink are sent as they are.
+     */
+    class xcompressor
+    {
+    public:
+
+        // An empty or unavailable codec disables compression
+        xcompressor(const std::string& codec, int level, std::size_t threshold);
+
+        bool enabled() const noexcept;
+
+        // Returns true if message is of a type whose content may be compressed
+        bool accepts(const xpub_message& message) const;
+
+        // Same output as message.serialize when the content is not compressed
+        void serialize(const xpub_message& message,
+                       zmq::multipart_t& wire_msg,
+                       const xauthentication& auth) const;
+
+    private:
+
+        bool compress(const zmq::message_t& frame, zmq::message_t& res) const;
+
+        std::string m_codec;
+        int m_level;
+        std::size_t m_threshold;
+    };
+
+}
+
+#endif
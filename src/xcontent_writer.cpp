@@ -0,0 +1,258 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "xeus/xjson.hpp"
+#include "xcontent_writer.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        template <std::size_t N>
+        constexpr std::size_t literal_size(const char (&)[N])
+        {
+            return N - 1;
+        }
+
+        template <std::size_t N>
+        char* write_literal(char* out, const char (&literal)[N])
+        {
+            std::memcpy(out, literal, N - 1);
+            return out + N - 1;
+        }
+
+        // Same rules as the UTF-8 decoder of xjson: overlong forms,
+        // surrogates and code points above U+10FFFF are rejected.
+        bool is_valid_utf8(const std::string& str)
+        {
+            const unsigned char* it = reinterpret_cast<const unsigned char*>(str.data());
+            const unsigned char* end = it + str.size();
+            while (it != end)
+            {
+                unsigned char c = *it++;
+                if (c < 0x80)
+                {
+                    continue;
+                }
+
+                std::size_t trailing;
+                unsigned char min = 0x80;
+                unsigned char max = 0xBF;
+                if (c >= 0xC2 && c <= 0xDF)
+                {
+                    trailing = 1;
+                }
+                else if (c >= 0xE0 && c <= 0xEF)
+                {
+                    trailing = 2;
+                    min = c == 0xE0 ? 0xA0 : 0x80;
+                    max = c == 0xED ? 0x9F : 0xBF;
+                }
+                else if (c >= 0xF0 && c <= 0xF4)
+                {
+                    trailing = 3;
+                    min = c == 0xF0 ? 0x90 : 0x80;
+                    max = c == 0xF4 ? 0x8F : 0xBF;
+                }
+                else
+                {
+                    return false;
+                }
+
+                if (static_cast<std::size_t>(end - it) < trailing || *it < min || *it > max)
+                {
+                    return false;
+                }
+                ++it;
+                for (std::size_t i = 1; i < trailing; ++i, ++it)
+                {
+                    if (*it < 0x80 || *it > 0xBF)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Contents with strings which are not valid UTF-8 are dumped by
+        // xjson, which reports the error as for any other document.
+        zmq::message_t dump_content(const xjson& content)
+        {
+            std::string res = content.dump();
+            return zmq::message_t(res.data(), res.size());
+        }
+
+        // Size of str once escaped, quotes included
+        std::size_t string_size(const std::string& str)
+        {
+            std::size_t res = 2;
+            for (char c : str)
+            {
+                unsigned char uc = static_cast<unsigned char>(c);
+                switch (c)
+                {
+                case '"':
+                case '\\':
+                case '\b':
+                case '\f':
+                case '\n':
+                case '\r':
+                case '\t':
+                    res += 2;
+                    break;
+                default:
+                    res += uc < 0x20 ? 6 : 1;
+                    break;
+                }
+            }
+            return res;
+        }
+
+        char* write_string(char* out, const std::string& str)
+        {
+            static constexpr char digits[] = "0123456789abcdef";
+            *out++ = '"';
+            const char* begin = str.data();
+            const char* end = begin + str.size();
+            while (begin != end)
+            {
+                // Characters which need no escaping are copied by chunks
+                const char* plain = begin;
+                while (plain != end && static_cast<unsigned char>(*plain) >= 0x20 &&
+                       *plain != '"' && *plain != '\\')
+                {
+                    ++plain;
+                }
+                std::size_t size = static_cast<std::size_t>(plain - begin);
+                std::memcpy(out, begin, size);
+                out += size;
+                if (plain == end)
+                {
+                    break;
+                }
+
+                unsigned char c = static_cast<unsigned char>(*plain);
+                *out++ = '\\';
+                switch (c)
+                {
+                case '"':
+                    *out++ = '"';
+                    break;
+                case '\\':
+                    *out++ = '\\';
+                    break;
+                case '\b':
+                    *out++ = 'b';
+                    break;
+                case '\f':
+                    *out++ = 'f';
+                    break;
+                case '\n':
+                    *out++ = 'n';
+                    break;
+                case '\r':
+                    *out++ = 'r';
+                    break;
+                case '\t':
+                    *out++ = 't';
+                    break;
+                default:
+                    out = write_literal(out, "u00");
+                    *out++ = digits[c >> 4];
+                    *out++ = digits[c & 0x0F];
+                    break;
+                }
+                begin = plain + 1;
+            }
+            *out++ = '"';
+            return out;
+        }
+    }
+
+    zmq::message_t make_status_content(const std::string& execution_state)
+    {
+        if (!is_valid_utf8(execution_state))
+        {
+            xjson content;
+            content["execution_state"] = execution_state;
+            return dump_content(content);
+        }
+
+        const char key[] = "{\"execution_state\":";
+        zmq::message_t res(literal_size(key) + string_size(execution_state) + 1);
+        char* out = res.data<char>();
+        out = write_literal(out, key);
+        out = write_string(out, execution_state);
+        *out = '}';
+        return res;
+    }
+
+    zmq::message_t make_stream_content(const std::string& name,
+                                       const std::string& text)
+    {
+        if (!is_valid_utf8(name) || !is_valid_utf8(text))
+        {
+            xjson content;
+            content["name"] = name;
+            content["text"] = text;
+            return dump_content(content);
+        }
+
+        const char name_key[] = "{\"name\":";
+        const char text_key[] = ",\"text\":";
+        zmq::message_t res(literal_size(name_key) + string_size(name) +
+                           literal_size(text_key) + string_size(text) + 1);
+        char* out = res.data<char>();
+        out = write_literal(out, name_key);
+        out = write_string(out, name);
+        out = write_literal(out, text_key);
+        out = write_string(out, text);
+        *out = '}';
+        return res;
+    }
+
+    zmq::message_t make_execute_input_content(const std::string& code,
+                                              int execution_count)
+    {
+        if (!is_valid_utf8(code))
+        {
+            xjson content;
+            content["code"] = code;
+            content["execution_count"] = execution_count;
+            return dump_content(content);
+        }
+
+        const char code_key[] = "{\"code\":";
+        const char count_key[] = ",\"execution_count\":";
+        char count[16];
+        int count_size = std::snprintf(count, sizeof(count), "%d", execution_count);
+        zmq::message_t res(literal_size(code_key) + string_size(code) +
+                           literal_size(count_key) + static_cast<std::size_t>(count_size) + 1);
+        char* out = res.data<char>();
+        out = write_literal(out, code_key);
+        out = write_string(out, code);
+        out = write_literal(out, count_key);
+        std::memcpy(out, count, static_cast<std::size_t>(count_size));
+        out += count_size;
+        *out = '}';
+        return res;
+    }
+
+    zmq::message_t make_clear_output_content(bool wait)
+    {
+        const char true_content[] = "{\"wait\":true}";
+        const char false_content[] = "{\"wait\":false}";
+        return wait ? zmq::message_t(true_content, literal_size(true_content))
+                    : zmq::message_t(false_content, literal_size(false_content));
+    }
+}
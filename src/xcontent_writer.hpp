@@ -0,0 +1,35 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XCONTENT_WRITER_HPP
+#define XCONTENT_WRITER_HPP
+
+#include <string>
+
+#include "zmq.hpp"
+
+namespace xeus
+{
+    // Contents of the messages with a fixed schema, written straight
+    // into the frame without building a JSON document. The output is
+    // the same as the dump of the equivalent xjson: keys are sorted,
+    // and strings are escaped but not converted to ASCII. Strings which
+    // are not valid UTF-8 are left to xjson, which rejects them.
+
+    zmq::message_t make_status_content(const std::string& execution_state);
+
+    zmq::message_t make_stream_content(const std::string& name,
+                                       const std::string& text);
+
+    zmq::message_t make_execute_input_content(const std::string& code,
+                                              int execution_count);
+
+    zmq::message_t make_clear_output_content(bool wait);
+}
+
+#endif
@@ -0,0 +1,66 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include "xcontrol.hpp"
+#include "xmiddleware.hpp"
+
+namespace xeus
+{
+
+    xcontrol::xcontrol(zmq::context_t& context,
+                       const std::string& server_id,
+                       const std::string& transport,
+                       const std::string& ip,
+                       const std::string& port,
+                       const xsocket_options& options)
+        : m_control(context, zmq::socket_type::router),
+          m_controller(context, zmq::socket_type::sub)
+    {
+        set_socket_options(m_control, options);
+        m_control.bind(get_end_point(transport, ip, port));
+        m_controller.connect(get_controller_end_point(server_id));
+        m_controller.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    }
+
+    void xcontrol::send(zmq::multipart_t& message)
+    {
+        message.send(m_control);
+    }
+
+    void xcontrol::run(listener l)
+    {
+        zmq::pollitem_t items[] = {
+            { m_control, 0, ZMQ_POLLIN, 0 },
+            { m_controller, 0, ZMQ_POLLIN, 0 }
+        };
+
+        while (true)
+        {
+            zmq::poll(&items[0], 2, -1);
+
+            if (items[0].revents & ZMQ_POLLIN)
+            {
+                zmq::multipart_t wire_msg;
+                wire_msg.recv(m_control);
+                l(wire_msg);
+            }
+
+            if (items[1].revents & ZMQ_POLLIN)
+            {
+                // stop or restart message
+                break;
+            }
+        }
+    }
+
+    std::string xcontrol::port() const
+    {
+        return get_bound_port(m_control);
+    }
+
+}
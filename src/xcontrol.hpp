@@ -0,0 +1,60 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XCONTROL_HPP
+#define XCONTROL_HPP
+
+#include <functional>
+#include <string>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+#include "xeus/xkernel_configuration.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xcontrol
+     * @brief Serves the control channel on its own thread.
+     *
+     * Requests are handed to the listener on the thread running run(), so
+     * interrupt and shutdown requests get through while the shell is busy.
+     * Replies must be sent from that same thread, which is the case when
+     * they are sent by the listener.
+     */
+    class xcontrol
+    {
+
+    public:
+
+        using listener = std::function<void(zmq::multipart_t&)>;
+
+        xcontrol(zmq::context_t& context,
+                 const std::string& server_id,
+                 const std::string& transport,
+                 const std::string& ip,
+                 const std::string& port,
+                 const xsocket_options& options);
+
+        void send(zmq::multipart_t& message);
+        void run(listener l);
+
+        // Port the control channel is bound to, see get_bound_port
+        std::string port() const;
+
+    private:
+
+        zmq::socket_t m_control;
+        zmq::socket_t m_controller;
+    };
+
+}
+
+#endif
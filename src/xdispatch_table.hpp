@@ -0,0 +1,164 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XDISPATCH_TABLE_HPP
+#define XDISPATCH_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xeus
+{
+
+    /**
+     * @class xdispatch_table
+     * @brief Open addressing hash table mapping message types to handlers.
+     *
+     * Keys are hashed with FNV-1a and stored along with their hash, so a
+     * lookup from a raw character range (such as the message type read
+     * from a header frame) neither allocates nor compares more than the
+     * keys with the same hash. The load factor is kept under 1/2.
+     */
+    template <class H>
+    class xdispatch_table
+    {
+    public:
+
+        using handler_type = H;
+
+        xdispatch_table();
+
+        // Inserts or replaces the handler associated to key
+        void insert(const std::string& key, handler_type handler);
+
+        // Returns nullptr if no handler is registered for key
+        const handler_type* find(const char* key, std::size_t size) const;
+        const handler_type* find(const std::string& key) const;
+
+        std::size_t size() const noexcept;
+
+    private:
+
+        struct entry
+        {
+            std::uint32_t m_hash = 0;
+            bool m_used = false;
+            std::string m_key;
+            handler_type m_handler;
+        };
+
+        static std::uint32_t hash(const char* key, std::size_t size);
+
+        std::size_t probe(const char* key, std::size_t size, std::uint32_t h) const;
+        void grow();
+
+        std::vector<entry> m_entries;
+        std::size_t m_size;
+    };
+
+    /*************************************
+     * xdispatch_table<H> implementation *
+     *************************************/
+
+    template <class H>
+    inline xdispatch_table<H>::xdispatch_table()
+        : m_entries(32), m_size(0)
+    {
+    }
+
+    template <class H>
+    inline void xdispatch_table<H>::insert(const std::string& key, handler_type handler)
+    {
+        if (2 * (m_size + 1) > m_entries.size())
+        {
+            grow();
+        }
+        std::uint32_t h = hash(key.c_str(), key.size());
+        entry& e = m_entries[probe(key.c_str(), key.size(), h)];
+        if (!e.m_used)
+        {
+            e.m_hash = h;
+            e.m_used = true;
+            e.m_key = key;
+            ++m_size;
+        }
+        e.m_handler = std::move(handler);
+    }
+
+    template <class H>
+    inline auto xdispatch_table<H>::find(const char* key, std::size_t size) const -> const handler_type*
+    {
+        const entry& e = m_entries[probe(key, size, hash(key, size))];
+        return e.m_used ? &e.m_handler : nullptr;
+    }
+
+    template <class H>
+    inline auto xdispatch_table<H>::find(const std::string& key) const -> const handler_type*
+    {
+        return find(key.c_str(), key.size());
+    }
+
+    template <class H>
+    inline std::size_t xdispatch_table<H>::size() const noexcept
+    {
+        return m_size;
+    }
+
+    template <class H>
+    inline std::uint32_t xdispatch_table<H>::hash(const char* key, std::size_t size)
+    {
+        std::uint32_t h = 2166136261u;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            h ^= static_cast<unsigned char>(key[i]);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // Returns the index of the entry holding key, or of the free entry
+    // where it should be inserted. The table is never full.
+    template <class H>
+    inline std::size_t xdispatch_table<H>::probe(const char* key, std::size_t size, std::uint32_t h) const
+    {
+        std::size_t mask = m_entries.size() - 1;
+        std::size_t index = h & mask;
+        while (m_entries[index].m_used)
+        {
+            const entry& e = m_entries[index];
+            if (e.m_hash == h && e.m_key.size() == size &&
+                std::memcmp(e.m_key.data(), key, size) == 0)
+            {
+                break;
+            }
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    template <class H>
+    inline void xdispatch_table<H>::grow()
+    {
+        std::vector<entry> old(2 * m_entries.size());
+        std::swap(old, m_entries);
+        for (entry& e : old)
+        {
+            if (e.m_used)
+            {
+                entry& dst = m_entries[probe(e.m_key.c_str(), e.m_key.size(), e.m_hash)];
+                dst = std::move(e);
+            }
+        }
+    }
+}
+
+#endif
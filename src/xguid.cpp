@@ -7,10 +7,12 @@
 ****************************************************************************/
 
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <string>
-#include <sstream>
-#include <iomanip>
 
 #include "xeus/xguid.hpp"
 #include "xstring_utils.hpp"
@@ -27,73 +29,278 @@
 #include <objbase.h>
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
 namespace xeus
 {
-
-    xguid new_xguid()
+    namespace
     {
-        static constexpr std::size_t GUID_SIZE = 16;
-        std::array<unsigned char, GUID_SIZE> buffer;
+        constexpr std::size_t GUID_SIZE = 16;
+        using guid_buffer = std::array<unsigned char, GUID_SIZE>;
+
+        // Only used to seed the generators
+        void platform_guid(guid_buffer& buffer)
+        {
 #ifdef GUID_LIBUUID
-        uuid_t id;
-        uuid_generate(id);
-        std::copy(id, id + GUID_SIZE, buffer.begin());
+            uuid_t id;
+            uuid_generate(id);
+            std::copy(id, id + GUID_SIZE, buffer.begin());
 #endif
 
 #ifdef GUID_CFUUID
-        auto id = CFUUIDCreate(NULL);
-        auto bytes = CFUUIDGetUUIDBytes(id);
-        CFRelease(id);
+            auto id = CFUUIDCreate(NULL);
+            auto bytes = CFUUIDGetUUIDBytes(id);
+            CFRelease(id);
 
-        buffer =
-        {
-            bytes.byte0,
-            bytes.byte1,
-            bytes.byte2,
-            bytes.byte3,
-            bytes.byte4,
-            bytes.byte5,
-            bytes.byte6,
-            bytes.byte7,
-            bytes.byte8,
-            bytes.byte9,
-            bytes.byte10,
-            bytes.byte11,
-            bytes.byte12,
-            bytes.byte13,
-            bytes.byte14,
-            bytes.byte15
-        };
+            buffer =
+            {
+                bytes.byte0,
+                bytes.byte1,
+                bytes.byte2,
+                bytes.byte3,
+                bytes.byte4,
+                bytes.byte5,
+                bytes.byte6,
+                bytes.byte7,
+                bytes.byte8,
+                bytes.byte9,
+                bytes.byte10,
+                bytes.byte11,
+                bytes.byte12,
+                bytes.byte13,
+                bytes.byte14,
+                bytes.byte15
+            };
 #endif
 
 #ifdef GUID_WINDOWS
-        GUID id;
-        CoCreateGuid(&id);
+            GUID id;
+            CoCreateGuid(&id);
+
+            using uchar = unsigned char;
+
+            buffer =
+            {
+                uchar(id.Data1 >> 24 & 0xFF),
+                uchar(id.Data1 >> 16 & 0xFF),
+                uchar(id.Data1 >> 8 & 0xFF),
+                uchar(id.Data1 & 0xFF),
+                uchar(id.Data2 >> 8 & 0xFF),
+                uchar(id.Data2 & 0xFF),
+                uchar(id.Data3 >> 8 & 0xFF),
+                uchar(id.Data3 & 0xFF),
+                id.Data4[0],
+                id.Data4[1],
+                id.Data4[2],
+                id.Data4[3],
+                id.Data4[4],
+                id.Data4[5],
+                id.Data4[6],
+                id.Data4[7]
+            };
+#endif
+        }
+
+        std::uint64_t load_uint64(const unsigned char* data) noexcept
+        {
+            std::uint64_t res = 0;
+            for (std::size_t i = 0; i < 8; ++i)
+            {
+                res = (res << 8) | data[i];
+            }
+            return res;
+        }
 
-        using uchar = unsigned char;
+        void store_uint64(std::uint64_t value, unsigned char* out) noexcept
+        {
+            for (std::size_t i = 0; i < 8; ++i)
+            {
+                out[i] = static_cast<unsigned char>(value >> (56 - 8 * i));
+            }
+        }
 
-        buffer =
+        /**
+         * xoshiro256** (Blackman and Vigna). jump advances the state by
+         * 2^128 steps, threads get non-overlapping sequences by starting
+         * from successive jumps of the same seed.
+         */
+        class xoshiro256
         {
-            uchar(id.Data1 >> 24 & 0xFF),
-            uchar(id.Data1 >> 16 & 0xFF),
-            uchar(id.Data1 >> 8 & 0xFF),
-            uchar(id.Data1 & 0xFF),
-            uchar(id.Data2 >> 8 & 0xFF),
-            uchar(id.Data2 & 0xFF),
-            uchar(id.Data3 >> 8 & 0xFF),
-            uchar(id.Data3 & 0xFF),
-            id.Data4[0],
-            id.Data4[1],
-            id.Data4[2],
-            id.Data4[3],
-            id.Data4[4],
-            id.Data4[5],
-            id.Data4[6],
-            id.Data4[7]
+        public:
+
+            void seed(const guid_buffer& lhs, const guid_buffer& rhs) noexcept
+            {
+                m_state[0] = load_uint64(lhs.data());
+                m_state[1] = load_uint64(lhs.data() + 8);
+                m_state[2] = load_uint64(rhs.data());
+                m_state[3] = load_uint64(rhs.data() + 8);
+            }
+
+            std::uint64_t next() noexcept
+            {
+                std::uint64_t res = rotl(m_state[1] * 5, 7) * 9;
+                std::uint64_t t = m_state[1] << 17;
+                m_state[2] ^= m_state[0];
+                m_state[3] ^= m_state[1];
+                m_state[1] ^= m_state[2];
+                m_state[0] ^= m_state[3];
+                m_state[2] ^= t;
+                m_state[3] = rotl(m_state[3], 45);
+                return res;
+            }
+
+            void jump() noexcept
+            {
+                static constexpr std::uint64_t polynomial[] = {
+                    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+                };
+                std::uint64_t s[4] = { 0, 0, 0, 0 };
+                for (std::uint64_t p : polynomial)
+                {
+                    for (int b = 0; b < 64; ++b)
+                    {
+                        if (p & (std::uint64_t(1) << b))
+                        {
+                            for (int i = 0; i < 4; ++i)
+                            {
+                                s[i] ^= m_state[i];
+                            }
+                        }
+                        next();
+                    }
+                }
+                for (int i = 0; i < 4; ++i)
+                {
+                    m_state[i] = s[i];
+                }
+            }
+
+        private:
+
+            static std::uint64_t rotl(std::uint64_t x, int k) noexcept
+            {
+                return (x << k) | (x >> (64 - k));
+            }
+
+            std::uint64_t m_state[4];
         };
+
+        // Seeded on first use. A forked child starts a new generation and
+        // is seeded again, so that it does not produce the ids of its parent.
+        struct xguid_seed
+        {
+            std::mutex m_mutex;
+            xoshiro256 m_generator;
+            bool m_seeded = false;
+            std::atomic<unsigned int> m_generation;
+
+            xguid_seed();
+        };
+
+        xguid_seed& get_guid_seed()
+        {
+            static xguid_seed seed;
+            return seed;
+        }
+
+#if defined(__unix__) || defined(__APPLE__)
+        void prepare_fork()
+        {
+            get_guid_seed().m_mutex.lock();
+        }
+
+        void resume_parent()
+        {
+            get_guid_seed().m_mutex.unlock();
+        }
+
+        void resume_child()
+        {
+            xguid_seed& seed = get_guid_seed();
+            seed.m_seeded = false;
+            seed.m_generation.fetch_add(1, std::memory_order_release);
+            seed.m_mutex.unlock();
+        }
 #endif
 
-        xguid res = hex_string(buffer);
-        return res;
+        xguid_seed::xguid_seed()
+            : m_generation(1)
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            pthread_atfork(prepare_fork, resume_parent, resume_child);
+#endif
+        }
+
+        struct xthread_generator
+        {
+            xoshiro256 m_generator;
+            unsigned int m_generation = 0;
+        };
+
+        xoshiro256& get_thread_generator()
+        {
+            thread_local xthread_generator local;
+            xguid_seed& seed = get_guid_seed();
+            unsigned int generation = seed.m_generation.load(std::memory_order_acquire);
+            if (local.m_generation != generation)
+            {
+                std::lock_guard<std::mutex> lock(seed.m_mutex);
+                if (!seed.m_seeded)
+                {
+                    guid_buffer lhs, rhs;
+                    platform_guid(lhs);
+                    platform_guid(rhs);
+                    seed.m_generator.seed(lhs, rhs);
+                    seed.m_seeded = true;
+                }
+                local.m_generator = seed.m_generator;
+                seed.m_generator.jump();
+                local.m_generation = seed.m_generation.load(std::memory_order_relaxed);
+            }
+            return local.m_generator;
+        }
+
+        xguid to_xguid(const guid_buffer& buffer)
+        {
+            char hex_buffer[2 * GUID_SIZE];
+            hex_encode(buffer.data(), GUID_SIZE, hex_buffer);
+            return xguid(hex_buffer, 2 * GUID_SIZE);
+        }
+
+        void set_variant(guid_buffer& buffer) noexcept
+        {
+            buffer[8] = static_cast<unsigned char>((buffer[8] & 0x3F) | 0x80);
+        }
+    }
+
+    xguid new_xguid()
+    {
+        guid_buffer buffer;
+        xoshiro256& generator = get_thread_generator();
+        store_uint64(generator.next(), buffer.data());
+        store_uint64(generator.next(), buffer.data() + 8);
+        buffer[6] = static_cast<unsigned char>((buffer[6] & 0x0F) | 0x40);
+        set_variant(buffer);
+        return to_xguid(buffer);
+    }
+
+    xguid new_time_ordered_xguid()
+    {
+        using namespace std::chrono;
+        std::uint64_t now = static_cast<std::uint64_t>(
+            duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count());
+        std::uint64_t milliseconds = now / 1000000;
+        // The 12 bits following the timestamp hold the fraction of the
+        // current millisecond (RFC 9562, method 3).
+        std::uint64_t fraction = ((now % 1000000) << 12) / 1000000;
+
+        guid_buffer buffer;
+        store_uint64((milliseconds << 16) | 0x7000 | fraction, buffer.data());
+        store_uint64(get_thread_generator().next(), buffer.data() + 8);
+        set_variant(buffer);
+        return to_xguid(buffer);
     }
 }
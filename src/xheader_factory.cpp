@@ -0,0 +1,107 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+
+#include "xeus/xguid.hpp"
+#include "xheader_factory.hpp"
+#include "xstring_utils.hpp"
+#include "xtimestamp.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        constexpr std::size_t msg_id_size = 32;
+
+        const char date_key[] = "{\"date\":\"";
+        const char msg_id_key[] = "\",\"msg_id\":\"";
+        const char msg_type_key[] = "\",\"msg_type\":";
+
+        template <std::size_t N>
+        constexpr std::size_t literal_size(const char (&)[N])
+        {
+            return N - 1;
+        }
+
+        // True if str can be written between quotes without escaping
+        bool is_plain_json_string(const std::string& str)
+        {
+            return std::none_of(str.begin(), str.end(), [](char c)
+            {
+                return static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\';
+            });
+        }
+
+        std::string json_string(const std::string& str)
+        {
+            return is_plain_json_string(str) ? '"' + str + '"' : xjson(str).dump();
+        }
+
+        char* write(char* out, const char* data, std::size_t size)
+        {
+            std::memcpy(out, data, size);
+            return out + size;
+        }
+    }
+
+    xheader_factory::xheader_factory(const std::string& user_name,
+                                     const std::string& session_id)
+        : m_suffix(",\"session\":" + json_string(session_id) +
+                   ",\"username\":" + json_string(user_name) +
+                   ",\"version\":" + json_string(get_protocol_version()) + "}"),
+          m_counter(0)
+    {
+        xguid prefix = new_xguid();
+        std::copy(prefix.cbegin(), prefix.cbegin() + id_prefix_size, m_id_prefix.begin());
+    }
+
+    xjson_frame xheader_factory::make_header(const std::string& msg_type) const
+    {
+        bool plain_type = is_plain_json_string(msg_type);
+        std::string escaped_type = plain_type ? std::string() : xjson(msg_type).dump();
+        std::size_t type_size = plain_type ? msg_type.size() + 2 : escaped_type.size();
+
+        std::size_t size = literal_size(date_key) + iso8601_size +
+            literal_size(msg_id_key) + msg_id_size +
+            literal_size(msg_type_key) + type_size + m_suffix.size();
+
+        zmq::message_t frame(size);
+        char* out = frame.data<char>();
+        out = write(out, date_key, literal_size(date_key));
+        out = write(out, iso8601_timestamp(), iso8601_size);
+        out = write(out, msg_id_key, literal_size(msg_id_key));
+        out = write(out, m_id_prefix.data(), id_prefix_size);
+
+        std::uint64_t count = m_counter.fetch_add(1, std::memory_order_relaxed);
+        unsigned char count_bytes[8];
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            count_bytes[i] = static_cast<unsigned char>(count >> (56 - 8 * i));
+        }
+        hex_encode(count_bytes, 8, out);
+        out += 16;
+
+        out = write(out, msg_type_key, literal_size(msg_type_key));
+        if (plain_type)
+        {
+            *out++ = '"';
+            out = write(out, msg_type.c_str(), msg_type.size());
+            *out++ = '"';
+        }
+        else
+        {
+            out = write(out, escaped_type.c_str(), escaped_type.size());
+        }
+        write(out, m_suffix.c_str(), m_suffix.size());
+
+        return xjson_frame(std::move(frame));
+    }
+
+}
@@ -0,0 +1,52 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XHEADER_FACTORY_HPP
+#define XHEADER_FACTORY_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "xeus/xmessage.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xheader_factory
+     * @brief Builds the serialized headers of the messages sent by a kernel.
+     *
+     * The fields that never change during a session (username, session and
+     * protocol version) are serialized once. Message ids are made of a
+     * random per-session prefix followed by a counter, and the date comes
+     * from the cached clock formatter (see iso8601_timestamp). The generated
+     * header is identical to the one make_header would produce once dumped.
+     */
+    class xheader_factory
+    {
+    public:
+
+        xheader_factory(const std::string& user_name,
+                        const std::string& session_id);
+
+        xjson_frame make_header(const std::string& msg_type) const;
+
+    private:
+
+        static constexpr std::size_t id_prefix_size = 16;
+
+        std::string m_suffix;
+        std::array<char, id_prefix_size> m_id_prefix;
+        mutable std::atomic<std::uint64_t> m_counter;
+    };
+
+}
+
+#endif
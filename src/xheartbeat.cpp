@@ -13,44 +13,57 @@
 
 namespace xeus
 {
+    constexpr std::size_t xheartbeat::poll_size;
 
     xheartbeat::xheartbeat(zmq::context_t& context,
+                           const std::string& server_id,
                            const std::string& transport,
                            const std::string& ip,
-                           const std::string& port)
+                           const std::string& port,
+                           const xsocket_options& options)
         : m_heartbeat(context, zmq::socket_type::router),
           m_controller(context, zmq::socket_type::sub)
     {
-        m_heartbeat.setsockopt(ZMQ_LINGER, get_socket_linger());
+        set_socket_options(m_heartbeat, options);
         m_heartbeat.bind(get_end_point(transport, ip, port));
-        m_controller.connect(get_controller_end_point());
-        m_controller.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+        m_controller.connect(get_controller_end_point(server_id));
+        // Restart messages are only for the control channel
+        m_controller.setsockopt(ZMQ_SUBSCRIBE, "stop", 4);
     }
 
-    void xheartbeat::run()
+    void xheartbeat::init_poll_items(zmq::pollitem_t* items)
     {
-        zmq::pollitem_t items[] = {
-            { m_heartbeat, 0, ZMQ_POLLIN, 0 },
-            { m_controller, 0, ZMQ_POLLIN, 0 }
-        };
+        items[0] = { m_heartbeat, 0, ZMQ_POLLIN, 0 };
+        items[1] = { m_controller, 0, ZMQ_POLLIN, 0 };
+    }
 
-        while (true)
+    bool xheartbeat::process(const zmq::pollitem_t* items)
+    {
+        if (items[0].revents & ZMQ_POLLIN)
         {
-            zmq::poll(&items[0], 2, -1);
-
-            if (items[0].revents & ZMQ_POLLIN)
-            {
-                zmq::multipart_t wire_msg;
-                wire_msg.recv(m_heartbeat);
-                wire_msg.send(m_heartbeat);
-            }
-
-            if (items[1].revents & ZMQ_POLLIN)
-            {
-                // stop or restart message
-                break;
-            }
+            zmq::multipart_t wire_msg;
+            wire_msg.recv(m_heartbeat);
+            wire_msg.send(m_heartbeat);
         }
+
+        // stop message
+        return !(items[1].revents & ZMQ_POLLIN);
+    }
+
+    void xheartbeat::run()
+    {
+        zmq::pollitem_t items[poll_size];
+        init_poll_items(&items[0]);
+        do
+        {
+            zmq::poll(&items[0], poll_size, -1);
+        }
+        while (process(&items[0]));
+    }
+
+    std::string xheartbeat::port() const
+    {
+        return get_bound_port(m_heartbeat);
     }
 
 }
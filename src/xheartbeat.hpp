@@ -9,8 +9,13 @@
 #ifndef XHEARTBEAT_HPP
 #define XHEARTBEAT_HPP
 
+#include <cstddef>
+#include <string>
+
 #include "zmq.hpp"
 
+#include "xeus/xkernel_configuration.hpp"
+
 namespace xeus
 {
 
@@ -20,12 +25,23 @@ namespace xeus
     public:
 
         xheartbeat(zmq::context_t& context,
+                   const std::string& server_id,
                    const std::string& transport,
                    const std::string& ip,
-                   const std::string& port);
+                   const std::string& port,
+                   const xsocket_options& options);
 
+        // Either run on its own thread, or served by an xserver_pump
         void run();
 
+        // Port the heartbeat channel is bound to, see get_bound_port
+        std::string port() const;
+
+        static constexpr std::size_t poll_size = 2;
+        void init_poll_items(zmq::pollitem_t* items);
+        // Returns false once the heartbeat has been stopped
+        bool process(const zmq::pollitem_t* items);
+
     private:
 
         zmq::socket_t m_heartbeat;
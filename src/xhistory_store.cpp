@@ -0,0 +1,309 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <unordered_set>
+
+#include "xeus/xhistory_store.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        std::uint32_t make_trigram(const char* data) noexcept
+        {
+            return (static_cast<std::uint32_t>(static_cast<unsigned char>(data[0])) << 16) |
+                (static_cast<std::uint32_t>(static_cast<unsigned char>(data[1])) << 8) |
+                static_cast<std::uint32_t>(static_cast<unsigned char>(data[2]));
+        }
+
+        bool is_wildcard(char c) noexcept
+        {
+            return c == '*' || c == '?';
+        }
+
+        // Matches the whole string, as SQL GLOB does
+        bool glob_match(const std::string& pattern, const std::string& str)
+        {
+            std::size_t p = 0;
+            std::size_t s = 0;
+            std::size_t star = std::string::npos;
+            std::size_t star_match = 0;
+            while (s < str.size())
+            {
+                if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == str[s]))
+                {
+                    ++p;
+                    ++s;
+                }
+                else if (p < pattern.size() && pattern[p] == '*')
+                {
+                    star = p++;
+                    star_match = s;
+                }
+                else if (star != std::string::npos)
+                {
+                    p = star + 1;
+                    s = ++star_match;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            while (p < pattern.size() && pattern[p] == '*')
+            {
+                ++p;
+            }
+            return p == pattern.size();
+        }
+
+        std::vector<std::uint32_t> trigrams(const char* begin, const char* end)
+        {
+            std::vector<std::uint32_t> res;
+            for (const char* iter = begin; end - iter >= 3; ++iter)
+            {
+                res.push_back(make_trigram(iter));
+            }
+            std::sort(res.begin(), res.end());
+            res.erase(std::unique(res.begin(), res.end()), res.end());
+            return res;
+        }
+    }
+
+    xhistory_store::xhistory_store()
+        : m_session(1)
+    {
+    }
+
+    xhistory_store::xhistory_store(const std::string& file_name)
+        : m_session(1)
+    {
+        load(file_name);
+        m_file.open(file_name, std::ios::out | std::ios::app);
+        if (!m_file)
+        {
+            std::cerr << "ERROR: could not open history file " << file_name << std::endl;
+        }
+    }
+
+    int xhistory_store::session() const noexcept
+    {
+        return m_session;
+    }
+
+    std::size_t xhistory_store::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+
+    void xhistory_store::append(int line_number, const std::string& input, const std::string& output)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.push_back({ m_session, line_number, input, output });
+        index(static_cast<std::uint32_t>(m_entries.size() - 1));
+        if (m_file.is_open())
+        {
+            xjson record = { m_session, line_number, input, output };
+            m_file << record.dump() << '\n';
+            m_file.flush();
+        }
+    }
+
+    xjson xhistory_store::history_request(const xhistory_arguments& args) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        index_list positions;
+        if (args.m_hist_access_type == "tail")
+        {
+            positions = tail(args.m_n);
+        }
+        else if (args.m_hist_access_type == "range")
+        {
+            positions = range(args.m_session, args.m_start, args.m_stop);
+        }
+        else if (args.m_hist_access_type == "search")
+        {
+            positions = search(args.m_pattern, args.m_n, args.m_unique);
+        }
+        return make_reply(positions, args.m_output);
+    }
+
+    void xhistory_store::load(const std::string& file_name)
+    {
+        std::ifstream ifs(file_name);
+        std::string line;
+        int last_session = 0;
+        while (std::getline(ifs, line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            try
+            {
+                xjson record = xjson::parse(line);
+                entry e = { record.at(0).get<int>(),
+                            record.at(1).get<int>(),
+                            record.at(2).get<std::string>(),
+                            record.at(3).get<std::string>() };
+                last_session = std::max(last_session, e.m_session);
+                m_entries.push_back(std::move(e));
+                index(static_cast<std::uint32_t>(m_entries.size() - 1));
+            }
+            catch (std::exception& e)
+            {
+                // A truncated last line is expected if a kernel crashed
+                std::cerr << "ERROR: skipping invalid history entry: " << e.what() << std::endl;
+            }
+        }
+        m_session = last_session + 1;
+    }
+
+    void xhistory_store::index(std::uint32_t position)
+    {
+        const entry& e = m_entries[position];
+        m_sessions[e.m_session].push_back(position);
+        const char* data = e.m_input.data();
+        for (std::uint32_t trigram : trigrams(data, data + e.m_input.size()))
+        {
+            m_trigrams[trigram].push_back(position);
+        }
+    }
+
+    auto xhistory_store::tail(int n) const -> index_list
+    {
+        std::size_t size = m_entries.size();
+        std::size_t count = n > 0 ? std::min(size, static_cast<std::size_t>(n)) : size;
+        index_list res(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            res[i] = static_cast<std::uint32_t>(size - count + i);
+        }
+        return res;
+    }
+
+    auto xhistory_store::range(int session, int start, int stop) const -> index_list
+    {
+        // 0 is the current session, negative numbers count back from it
+        int target = session > 0 ? session : m_session + session;
+        index_list res;
+        auto iter = m_sessions.find(target);
+        if (iter == m_sessions.end())
+        {
+            return res;
+        }
+        // A stop of 0 or less means up to the last entry
+        std::copy_if(iter->second.cbegin(), iter->second.cend(), std::back_inserter(res),
+                     [this, start, stop](std::uint32_t position)
+        {
+            int line_number = m_entries[position].m_line_number;
+            return line_number >= start && (stop <= 0 || line_number < stop);
+        });
+        return res;
+    }
+
+    auto xhistory_store::search(const std::string& pattern, int n, bool unique) const -> index_list
+    {
+        const std::string& glob = pattern.empty() ? std::string("*") : pattern;
+        index_list candidates;
+        bool indexed = search_candidates(glob, candidates);
+        std::size_t count = indexed ? candidates.size() : m_entries.size();
+
+        // The most recent matches are kept
+        index_list res;
+        std::unordered_set<std::string> seen;
+        for (std::size_t i = count; i != 0; --i)
+        {
+            std::uint32_t position = indexed ? candidates[i - 1] : static_cast<std::uint32_t>(i - 1);
+            const std::string& input = m_entries[position].m_input;
+            if (!glob_match(glob, input) || (unique && !seen.insert(input).second))
+            {
+                continue;
+            }
+            res.push_back(position);
+            if (n > 0 && res.size() == static_cast<std::size_t>(n))
+            {
+                break;
+            }
+        }
+        std::reverse(res.begin(), res.end());
+        return res;
+    }
+
+    bool xhistory_store::search_candidates(const std::string& pattern, index_list& candidates) const
+    {
+        std::vector<std::uint32_t> keys;
+        auto begin = pattern.cbegin();
+        while (begin != pattern.cend())
+        {
+            auto end = std::find_if(begin, pattern.cend(), is_wildcard);
+            std::vector<std::uint32_t> part = trigrams(&*begin, &*begin + (end - begin));
+            keys.insert(keys.end(), part.begin(), part.end());
+            begin = end == pattern.cend() ? end : end + 1;
+        }
+        if (keys.empty())
+        {
+            return false;
+        }
+
+        // Posting lists are sorted, they are intersected from the shortest one
+        std::vector<const index_list*> lists;
+        for (std::uint32_t key : keys)
+        {
+            auto iter = m_trigrams.find(key);
+            if (iter == m_trigrams.end())
+            {
+                candidates.clear();
+                return true;
+            }
+            lists.push_back(&iter->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](const index_list* lhs, const index_list* rhs)
+        {
+            return lhs->size() < rhs->size();
+        });
+
+        candidates = *lists.front();
+        index_list tmp;
+        for (auto iter = lists.cbegin() + 1; iter != lists.cend() && !candidates.empty(); ++iter)
+        {
+            tmp.clear();
+            std::set_intersection(candidates.cbegin(), candidates.cend(),
+                                  (*iter)->cbegin(), (*iter)->cend(),
+                                  std::back_inserter(tmp));
+            candidates.swap(tmp);
+        }
+        return true;
+    }
+
+    xjson xhistory_store::make_reply(const index_list& positions, bool output) const
+    {
+        xjson history = xjson::array();
+        for (std::uint32_t position : positions)
+        {
+            const entry& e = m_entries[position];
+            if (output)
+            {
+                history.push_back({ e.m_session, e.m_line_number, { e.m_input, e.m_output } });
+            }
+            else
+            {
+                history.push_back({ e.m_session, e.m_line_number, e.m_input });
+            }
+        }
+        xjson reply;
+        reply["status"] = "ok";
+        reply["history"] = std::move(history);
+        return reply;
+    }
+
+}
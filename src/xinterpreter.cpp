@@ -7,11 +7,13 @@
 ****************************************************************************/
 
 #include "xeus/xinterpreter.hpp"
+#include "xcontent_writer.hpp"
 
 namespace xeus
 {
 
-    xinterpreter::xinterpreter() : m_execution_count(0)
+    xinterpreter::xinterpreter()
+        : m_execution_count(0), p_comm_manager(nullptr), m_concurrent_requests(false)
     {
     }
 
@@ -74,49 +76,68 @@ namespace xeus
     void xinterpreter::register_publisher(const publisher_type& publisher)
     {
         m_publisher = publisher;
+        // The frame publisher must not bypass a publisher registered later
+        m_frame_publisher = frame_publisher_type();
+    }
+
+    void xinterpreter::register_frame_publisher(const frame_publisher_type& publisher)
+    {
+        m_frame_publisher = publisher;
     }
 
     void xinterpreter::publish_stream(const std::string& name, const std::string& text)
     {
-        if (m_publisher)
+        if (m_frame_publisher)
+        {
+            m_frame_publisher("stream", xjson_frame(make_stream_content(name, text)));
+        }
+        else if (m_publisher)
         {
             xjson content;
             content["name"] = name;
             content["text"] = text;
-            m_publisher("stream", xjson::object(), std::move(content));
+            m_publisher("stream", xjson::object(), std::move(content), buffer_sequence());
         }
     }
 
-    void xinterpreter::display_data(xjson data, xjson metadata, xjson transient)
+    void xinterpreter::display_data(xjson data, xjson metadata, xjson transient,
+                                    buffer_sequence buffers)
     {
         if (m_publisher)
         {
             m_publisher("display_data", xjson::object(),
                         build_display_content(std::move(data),
                                               std::move(metadata), 
-                                              std::move(transient)));
+                                              std::move(transient)),
+                        std::move(buffers));
         }
     }
 
-    void xinterpreter::update_display_data(xjson data, xjson metadata, xjson transient)
+    void xinterpreter::update_display_data(xjson data, xjson metadata, xjson transient,
+                                           buffer_sequence buffers)
     {
         if (m_publisher)
         {
             m_publisher("update_display_data", xjson::object(),
                         build_display_content(std::move(data),
                                               std::move(metadata),
-                                              std::move(transient)));
+                                              std::move(transient)),
+                        std::move(buffers));
         }
     }
 
     void xinterpreter::publish_execution_input(const std::string& code, int execution_count)
     {
-        if (m_publisher)
+        if (m_frame_publisher)
+        {
+            m_frame_publisher("execute_input", xjson_frame(make_execute_input_content(code, execution_count)));
+        }
+        else if (m_publisher)
         {
             xjson content;
             content["code"] = code;
             content["execution_count"] = execution_count;
-            m_publisher("execute_input", xjson::object(), std::move(content));
+            m_publisher("execute_input", xjson::object(), std::move(content), buffer_sequence());
         }
     }
 
@@ -128,7 +149,7 @@ namespace xeus
             content["execution_count"] = execution_count;
             content["data"] = std::move(data);
             content["metadata"] = std::move(metadata);
-            m_publisher("execute_result", xjson::object(), std::move(content));
+            m_publisher("execute_result", xjson::object(), std::move(content), buffer_sequence());
         }
     }
 
@@ -141,17 +162,21 @@ namespace xeus
             content["ename"] = ename;
             content["evalue"] = evalue;
             content["traceback"] = trace_back;
-            m_publisher("error", xjson::object(), std::move(content));
+            m_publisher("error", xjson::object(), std::move(content), buffer_sequence());
         }
     }
 
     void xinterpreter::clear_output(bool wait)
     {
-        if (m_publisher)
+        if (m_frame_publisher)
+        {
+            m_frame_publisher("clear_output", xjson_frame(make_clear_output_content(wait)));
+        }
+        else if (m_publisher)
         {
             xjson content;
             content["wait"] = wait;
-            m_publisher("clear_output", xjson::object(), std::move(content));
+            m_publisher("clear_output", xjson::object(), std::move(content), buffer_sequence());
         }
     }
 
@@ -165,6 +190,31 @@ namespace xeus
         p_comm_manager = manager;
     }
 
+    void xinterpreter::register_request_handler(const std::string& msg_type,
+                                                const std::string& reply_type,
+                                                const request_handler_type& handler)
+    {
+        if (m_registrar)
+        {
+            m_registrar(msg_type, reply_type, handler);
+        }
+        else
+        {
+            // Forwarded to the kernel once it registers itself
+            m_pending_handlers.push_back({msg_type, reply_type, handler});
+        }
+    }
+
+    void xinterpreter::register_handler_registrar(const handler_registrar_type& registrar)
+    {
+        m_registrar = registrar;
+        for (const auto& pending : m_pending_handlers)
+        {
+            m_registrar(pending.m_msg_type, pending.m_reply_type, pending.m_handler);
+        }
+        m_pending_handlers.clear();
+    }
+
     void xinterpreter::input_request(const std::string& prompt, bool pwd)
     {
         if (m_stdin)
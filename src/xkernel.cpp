@@ -6,9 +6,16 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <exception>
+#include <iostream>
+#include <thread>
+
 #include "xeus/xkernel.hpp"
 #include "xeus/xguid.hpp"
+#include "xcompression.hpp"
+#include "xcontent_writer.hpp"
 #include "xkernel_core.hpp"
+#include "xmiddleware.hpp"
 
 #if (defined(__linux__) || defined(__unix__))
 #define LINUX_PLATFORM
@@ -43,14 +50,11 @@ namespace xeus
                          zmq::multipart_t& wire_msg)
     {
         std::string topic = "kernel_core." + kernel_id + ".status";
-        xjson content;
-        content["execution_state"] = "starting";
-
         xpub_message msg(topic,
                          make_header("status", user_name, session_id),
                          xjson::object(),
                          xjson::object(),
-                         std::move(content));
+                         xjson_frame(make_status_content("starting")));
         msg.serialize(wire_msg, *auth);
     }
 
@@ -67,23 +71,88 @@ namespace xeus
 
     void xkernel::start()
     {
-        std::string kernel_id = new_xguid();
-        std::string session_id = new_xguid();
+        // Options must be set before the first socket is created
+        zmq::context_t context;
+        set_context_options(context, m_config);
+        start(context, m_builder(context, m_config));
+    }
 
-        using authentication_ptr = xkernel_core::authentication_ptr;
-        authentication_ptr auth = make_xauthentication(m_config.m_signature_scheme, m_config.m_key);
+    void xkernel::start(zmq::context_t& /*context*/, server_ptr server)
+    {
+        bool restart_in_process = m_config.m_restart_in_process && m_interpreter_builder;
+        bool restart = false;
+        do
+        {
+            if (restart)
+            {
+                // The previous core has been destroyed, nothing
+                // refers to the previous interpreter anymore.
+                p_interpreter = m_interpreter_builder();
+            }
 
-        zmq::multipart_t start_msg;
-        build_start_msg(auth, kernel_id, m_user_name, session_id, start_msg);
+            std::string kernel_id = new_xguid();
+            std::string session_id = new_xguid();
 
-        zmq::context_t context;
-        server_ptr server = m_builder(context, m_config);
+            using authentication_ptr = xkernel_core::authentication_ptr;
+            authentication_ptr auth = make_xauthentication(m_config.m_signature_scheme, m_config.m_key);
+
+            zmq::multipart_t start_msg;
+            build_start_msg(auth, kernel_id, m_user_name, session_id, start_msg);
 
-        xkernel_core core(kernel_id, m_user_name, session_id,
-                          std::move(auth), server.get(), p_interpreter.get());
+            xkernel_core core(kernel_id, m_user_name, session_id,
+                              std::move(auth), server.get(), p_interpreter.get(),
+                              m_config.m_status_coalescing, restart_in_process,
+                              compression_info(m_config.m_iopub_compression,
+                                               m_config.m_iopub_compression_threshold));
 
-        p_interpreter->configure(); 
-        server->start(start_msg);
+            std::thread configure_thread;
+            if (m_config.m_background_configure)
+            {
+                // The starting status is published and kernel_info_requests
+                // are answered while the interpreter is configured.
+                xserver* raw_server = server.get();
+                raw_server->hold_shell({ "kernel_info_request" });
+                configure_thread = std::thread([this, raw_server]()
+                {
+                    try
+                    {
+                        p_interpreter->configure();
+                    }
+                    catch (std::exception& e)
+                    {
+                        std::cerr << "ERROR: interpreter configuration failed: " << e.what() << std::endl;
+                    }
+                    raw_server->release_shell();
+                });
+            }
+            else
+            {
+                p_interpreter->configure();
+            }
+
+            server->start(start_msg);
+            if (configure_thread.joinable())
+            {
+                configure_thread.join();
+            }
+            restart = core.restart_requested();
+        }
+        while (restart);
+    }
+
+    const xconfiguration& xkernel::configuration() const noexcept
+    {
+        return m_config;
+    }
+
+    xmetrics_snapshot xkernel::metrics() const
+    {
+        return get_metrics();
+    }
+
+    void xkernel::register_interpreter_builder(const interpreter_builder& builder)
+    {
+        m_interpreter_builder = builder;
     }
 
 }
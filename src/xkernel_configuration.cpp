@@ -12,6 +12,31 @@
 
 namespace xeus
 {
+    namespace
+    {
+        xsocket_options load_socket_options(const xjson& doc)
+        {
+            xsocket_options res;
+            res.m_linger = doc.value("linger", res.m_linger);
+            res.m_sndhwm = doc.value("sndhwm", res.m_sndhwm);
+            res.m_rcvhwm = doc.value("rcvhwm", res.m_rcvhwm);
+            res.m_sndbuf = doc.value("sndbuf", res.m_sndbuf);
+            res.m_rcvbuf = doc.value("rcvbuf", res.m_rcvbuf);
+            res.m_tcp_keepalive = doc.value("tcp_keepalive", res.m_tcp_keepalive);
+            res.m_tcp_keepalive_idle = doc.value("tcp_keepalive_idle", res.m_tcp_keepalive_idle);
+            res.m_tcp_keepalive_cnt = doc.value("tcp_keepalive_cnt", res.m_tcp_keepalive_cnt);
+            res.m_tcp_keepalive_intvl = doc.value("tcp_keepalive_intvl", res.m_tcp_keepalive_intvl);
+            res.m_immediate = doc.value("immediate", res.m_immediate);
+            res.m_use_fd = doc.value("use_fd", res.m_use_fd);
+            return res;
+        }
+
+        xsocket_options load_channel_options(const xjson& doc, const char* channel)
+        {
+            auto iter = doc.find(channel);
+            return iter != doc.end() ? load_socket_options(*iter) : xsocket_options();
+        }
+    }
 
     xconfiguration load_configuration(const std::string& file_name)
     {
@@ -37,6 +62,40 @@ namespace xeus
         {
             res.m_key = "";
         }
+        res.m_stream_batch_window = doc.value("stream_batch_window", res.m_stream_batch_window);
+        res.m_stream_batch_size = doc.value("stream_batch_size", res.m_stream_batch_size);
+        res.m_stdin_timeout = doc.value("stdin_timeout", res.m_stdin_timeout);
+        res.m_status_coalescing = doc.value("status_coalescing", res.m_status_coalescing);
+        res.m_shell_priority = doc.value("shell_priority", res.m_shell_priority);
+        res.m_shell_priority_burst = doc.value("shell_priority_burst", res.m_shell_priority_burst);
+        res.m_publish_queue_size = doc.value("publish_queue_size", res.m_publish_queue_size);
+        res.m_publish_policy = doc.value("publish_policy", res.m_publish_policy);
+        res.m_iopub_replay_port = doc.value("iopub_replay_port", res.m_iopub_replay_port);
+        res.m_iopub_replay_size = doc.value("iopub_replay_size", res.m_iopub_replay_size);
+        res.m_iopub_replay_bytes = doc.value("iopub_replay_bytes", res.m_iopub_replay_bytes);
+        res.m_iopub_compression = doc.value("iopub_compression", res.m_iopub_compression);
+        res.m_iopub_compression_level = doc.value("iopub_compression_level", res.m_iopub_compression_level);
+        res.m_iopub_compression_threshold = doc.value("iopub_compression_threshold", res.m_iopub_compression_threshold);
+
+        res.m_dedicated_heartbeat = doc.value("dedicated_heartbeat", res.m_dedicated_heartbeat);
+        res.m_restart_in_process = doc.value("restart_in_process", res.m_restart_in_process);
+        res.m_background_configure = doc.value("background_configure", res.m_background_configure);
+        res.m_metrics_port = doc.value("metrics_port", res.m_metrics_port);
+        res.m_shm_name = doc.value("shm_name", res.m_shm_name);
+        res.m_shm_size = doc.value("shm_size", res.m_shm_size);
+        res.m_shm_threshold = doc.value("shm_threshold", res.m_shm_threshold);
+
+        auto options = doc.find("socket_options");
+        if (options != doc.end())
+        {
+            res.m_io_threads = options->value("io_threads", res.m_io_threads);
+            res.m_io_thread_affinity = options->value("io_thread_affinity", res.m_io_thread_affinity);
+            res.m_shell_options = load_channel_options(*options, "shell");
+            res.m_control_options = load_channel_options(*options, "control");
+            res.m_stdin_options = load_channel_options(*options, "stdin");
+            res.m_iopub_options = load_channel_options(*options, "iopub");
+            res.m_hb_options = load_channel_options(*options, "hb");
+        }
 
         return res;
     }
@@ -6,58 +6,126 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <algorithm>
 #include <exception>
 #include <functional>
 #include <iostream>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include "xkernel_core.hpp"
-
-using namespace std::placeholders;
+#include "xcontent_writer.hpp"
+#include "xmetrics.hpp"
 
 namespace xeus
 {
+    namespace
+    {
+        constexpr std::size_t worker_pool_size = 2;
+        // Bounds the latency of a batch of coalesced comm_msgs
+        constexpr std::size_t max_comm_batch_size = 1024;
+        // Requests received this long after an execute_request
+        // failed with stop_on_error are aborted too (in milliseconds).
+        constexpr long abort_grace_period = 50;
+
+        // Request being handled by the current thread, its identities and
+        // header are used as the parent of replies and published messages.
+        thread_local const xrequest_context* p_current_request = nullptr;
+
+        const xrequest_context& current_request()
+        {
+            static const xrequest_context empty_context;
+            return p_current_request != nullptr ? *p_current_request : empty_context;
+        }
+
+        class xrequest_scope
+        {
+        public:
+
+            explicit xrequest_scope(const xrequest_context& context)
+                : p_previous(p_current_request)
+            {
+                p_current_request = &context;
+            }
+
+            ~xrequest_scope()
+            {
+                p_current_request = p_previous;
+            }
+
+            xrequest_scope(const xrequest_scope&) = delete;
+            xrequest_scope& operator=(const xrequest_scope&) = delete;
+
+        private:
+
+            const xrequest_context* p_previous;
+        };
+    }
 
     xkernel_core::xkernel_core(const std::string& kernel_id,
                                const std::string& user_name,
                                const std::string& session_id,
                                authentication_ptr auth,
                                server_ptr server,
-                               interpreter_ptr interpreter)
+                               interpreter_ptr interpreter,
+                               const std::vector<std::string>& status_coalescing,
+                               bool restart_in_process,
+                               xjson iopub_compression)
         : m_kernel_id(std::move(kernel_id)),
           m_user_name(std::move(user_name)),
           m_session_id(std::move(session_id)),
+          m_header_factory(m_user_name, m_session_id),
           p_auth(std::move(auth)),
           m_comm_manager(this),
           p_server(server),
           p_interpreter(interpreter),
-          m_parent_id(0),
-          m_parent_header(xjson::object())
+          m_status_coalescing(status_coalescing),
+          m_restart_in_process(restart_in_process),
+          m_restart_requested(false),
+          m_iopub_compression(std::move(iopub_compression))
     {
         // Request handlers
-        m_handler["execute_request"] = &xkernel_core::execute_request;
-        m_handler["complete_request"] = &xkernel_core::complete_request;
-        m_handler["inspect_request"] = &xkernel_core::inspect_request;
-        m_handler["history_request"] = &xkernel_core::history_request;
-        m_handler["is_complete_request"] = &xkernel_core::is_complete_request;
-        m_handler["comm_info_request"] = &xkernel_core::comm_info_request;
-        m_handler["comm_open"] = &xkernel_core::comm_open;
-        m_handler["comm_close"] = &xkernel_core::comm_close;
-        m_handler["comm_msg"] = &xkernel_core::comm_msg;
-        m_handler["kernel_info_request"] = &xkernel_core::kernel_info_request;
-        m_handler["shutdown_request"] = &xkernel_core::shutdown_request;
-        m_handler["interrupt_request"] = &xkernel_core::interrupt_request;
+        register_handler("execute_request", &xkernel_core::execute_request);
+        register_handler("complete_request", &xkernel_core::complete_request, handler_policy::concurrent);
+        register_handler("inspect_request", &xkernel_core::inspect_request, handler_policy::concurrent);
+        register_handler("history_request", &xkernel_core::history_request);
+        register_handler("is_complete_request", &xkernel_core::is_complete_request, handler_policy::concurrent);
+        register_handler("comm_info_request", &xkernel_core::comm_info_request);
+        register_handler("comm_open", &xkernel_core::comm_open);
+        register_handler("comm_close", &xkernel_core::comm_close);
+        register_handler("comm_msg", &xkernel_core::comm_msg);
+        register_handler("kernel_info_request", &xkernel_core::kernel_info_request);
+        register_handler("shutdown_request", &xkernel_core::shutdown_request, handler_policy::lock_free);
+        register_handler("interrupt_request", &xkernel_core::interrupt_request, handler_policy::lock_free);
 
         // Server bindings
-        p_server->register_shell_listener(std::bind(&xkernel_core::dispatch_shell, this, _1));
-        p_server->register_control_listener(std::bind(&xkernel_core::dispatch_control, this, _1));
-        p_server->register_stdin_listener(std::bind(&xkernel_core::dispatch_stdin, this, _1));
+        p_server->register_shell_listener([this](zmq::multipart_t& wire_msg) { dispatch_shell(wire_msg); });
+        p_server->register_control_listener([this](zmq::multipart_t& wire_msg) { dispatch_control(wire_msg); });
+        p_server->register_stdin_listener([this](zmq::multipart_t& wire_msg) { dispatch_stdin(wire_msg); });
+        p_server->register_idle_listener([this]() { publish_deferred_idle(); });
 
         // Interpreter bindings
-        p_interpreter->register_publisher(std::bind(&xkernel_core::publish_message, this, _1, _2, _3));
-        p_interpreter->register_stdin_sender(std::bind(&xkernel_core::send_stdin, this, _1, _2, _3));
+        p_interpreter->register_publisher([this](const std::string& msg_type, xjson metadata,
+                                                 xjson content, buffer_sequence buffers)
+        {
+            publish_message(msg_type, std::move(metadata), std::move(content), std::move(buffers));
+        });
+        p_interpreter->register_frame_publisher([this](const std::string& msg_type, xjson_frame content)
+        {
+            publish_message(msg_type, xjson::object(), std::move(content));
+        });
+        p_interpreter->register_stdin_sender([this](const std::string& msg_type, xjson metadata, xjson content)
+        {
+            send_stdin(msg_type, std::move(metadata), std::move(content));
+        });
         p_interpreter->register_comm_manager(&m_comm_manager);
+        p_interpreter->register_handler_registrar([this](const std::string& msg_type,
+                                                         const std::string& reply_type,
+                                                         const xinterpreter::request_handler_type& handler)
+        {
+            register_request_handler(msg_type, reply_type, handler);
+        });
     }
 
     void xkernel_core::dispatch_shell(zmq::multipart_t& wire_msg)
@@ -84,31 +152,50 @@ namespace xeus
             return;
         }
 
-        const xjson& header = msg.header();
-        std::string msg_type = header.value("msg_type", "");
+        if (msg.msg_type() == "input_reply")
+        {
+            const xjson& content = msg.content();
+            p_interpreter->input_reply(content.value("value", ""));
+        }
+        else
+        {
+            std::cerr << "ERROR: received unknown message on stdin" << std::endl;
+        }
     }
 
     void xkernel_core::publish_message(const std::string& msg_type,
                                        xjson metadata,
-                                       xjson content)
+                                       xjson_frame content,
+                                       buffer_sequence buffers)
+    {
+        publish_message(current_request(), msg_type, std::move(metadata),
+                        std::move(content), std::move(buffers));
+    }
+
+    void xkernel_core::publish_message(const xrequest_context& context,
+                                       const std::string& msg_type,
+                                       xjson metadata,
+                                       xjson_frame content,
+                                       buffer_sequence buffers)
     {
         xpub_message msg(get_topic(msg_type),
-                         make_header(msg_type, m_user_name, m_session_id),
-                         get_parent_header(),
+                         m_header_factory.make_header(msg_type),
+                         context.header(),
                          std::move(metadata),
-                         std::move(content));
-        zmq::multipart_t wire_msg;
-        msg.serialize(wire_msg, *p_auth);
-        p_server->publish(wire_msg);
+                         std::move(content),
+                         std::move(buffers));
+        // Serialized and signed by the iopub thread
+        p_server->publish(std::move(msg));
     }
 
     void xkernel_core::send_stdin(const std::string& msg_type,
                                   xjson metadata,
                                   xjson content)
     {
-        xmessage msg(get_parent_id(),
-                     make_header(msg_type, m_user_name, m_session_id),
-                     get_parent_header(),
+        const xrequest_context& context = current_request();
+        xmessage msg(context.id(),
+                     m_header_factory.make_header(msg_type),
+                     context.header(),
                      std::move(metadata),
                      std::move(content));
         zmq::multipart_t wire_msg;
@@ -131,51 +218,194 @@ namespace xeus
         return m_comm_manager;
     }
 
+    bool xkernel_core::restart_requested() const noexcept
+    {
+        return m_restart_requested;
+    }
+
     void xkernel_core::dispatch(zmq::multipart_t& wire_msg, channel c)
     {
         xmessage msg;
+        if (!deserialize(wire_msg, msg))
+        {
+            return;
+        }
+
+        // Handling a request may receive the next one from the shell
+        // channel (see comm_msg_batch), which is then handled in turn.
+        while (handle_request(msg, c))
+        {
+        }
+    }
+
+    bool xkernel_core::deserialize(zmq::multipart_t& wire_msg, xmessage& msg) const
+    {
         try
         {
             msg.deserialize(wire_msg, *p_auth);
+            return true;
         }
         catch (std::exception& e)
         {
             std::cerr << "ERROR: could not deserialize message" << std::endl;
             std::cerr << e.what() << std::endl;
-            return;
+            return false;
+        }
+    }
+
+    bool xkernel_core::handle_request(xmessage& msg, channel c)
+    {
+        xrequest_context::pointer context = std::make_shared<const xrequest_context>(msg);
+        xrequest_scope scope(*context);
+
+        // The message type is looked up in place in the header frame,
+        // it is only copied when the header has to be parsed.
+        const char* type_data;
+        std::size_t type_size;
+        std::string msg_type;
+        if (!msg.raw_msg_type(type_data, type_size))
+        {
+            msg_type = msg.msg_type();
+            type_data = msg_type.c_str();
+            type_size = msg_type.size();
         }
 
-        const xjson& header = msg.header();
-        set_parent(msg.identities(), header);
-        publish_status("busy");
+        const xhandler* handler = get_handler(type_data, type_size);
+        XEUS_METRICS_COUNT(type_data, type_size);
+
+        bool pooled = handler != nullptr && c == channel::SHELL &&
+            handler->m_policy == handler_policy::concurrent &&
+            p_interpreter->concurrent_requests();
+        // Pooled requests complete out of order, their idle status
+        // is published by the worker as soon as they are done.
+        bool coalesce = handler != nullptr && c == channel::SHELL &&
+            handler->m_coalesce_status && !pooled;
+        publish_busy(*context, c, coalesce);
+
+        if (pooled)
+        {
+            submit_request(handler, std::move(msg), context);
+            return false;
+        }
+
+        // Requests received on the control channel while a shell request
+        // is running wait for its completion, unless they are lock free.
+        std::unique_lock<std::mutex> lock(m_dispatch_mutex, std::defer_lock);
+        if (handler == nullptr || handler->m_policy != handler_policy::lock_free)
+        {
+            lock.lock();
+        }
+
+        bool has_next = false;
+        context_list batched;
+        if (handler != nullptr && handler->m_member == &xkernel_core::comm_msg &&
+            c == channel::SHELL && m_comm_manager.message_coalescing())
+        {
+            has_next = comm_msg_batch(msg, batched, coalesce);
+        }
+        else
+        {
+            run_handler(handler, msg, c);
+        }
+
+        lock.unlock();
+        // The kernel stays busy until the request which
+        // received the first status is done.
+        for (const auto& batched_context : batched)
+        {
+            publish_idle(batched_context, coalesce);
+        }
+        publish_idle(context, coalesce);
+        return has_next;
+    }
 
-        std::string msg_type = header.value("msg_type", "");
-        handler_type handler = get_handler(msg_type);
+    void xkernel_core::run_handler(const xhandler* handler, const xmessage& request, channel c)
+    {
         if (handler == nullptr)
         {
             std::cerr << "ERROR: received unknown message" << std::endl;
+            return;
         }
-        else
+
+        XEUS_METRICS_TIME(m_handler);
+        try
         {
-            try
+            if (handler->m_member != nullptr)
             {
-                (this->*handler)(msg, c);
+                (this->*(handler->m_member))(request, c);
             }
-            catch (std::exception& e)
+            else
             {
-                std::cerr << "ERROR: received bad message: " << e.what() << std::endl;
-                std::cerr << "Message content: " << msg.content() << std::endl;
+                custom_request(request, *handler, c);
             }
         }
+        catch (std::exception& e)
+        {
+            std::cerr << "ERROR: received bad message: " << e.what() << std::endl;
+            std::cerr << "Message content: " << request.content() << std::endl;
+        }
+    }
+
+    void xkernel_core::submit_request(const xhandler* handler,
+                                      xmessage request,
+                                      xrequest_context::pointer context)
+    {
+        if (p_worker_pool == nullptr)
+        {
+            p_worker_pool.reset(new xthread_pool(worker_pool_size));
+        }
+
+        // The reply is sent from the worker thread, the server forwards
+        // it to the shell socket.
+        auto msg = std::make_shared<xmessage>(std::move(request));
+        p_worker_pool->submit([this, handler, msg, context]()
+        {
+            xrequest_scope scope(*context);
+            run_handler(handler, *msg, channel::SHELL);
+            publish_status(*context, "idle");
+        });
+    }
+
+    void xkernel_core::register_handler(const std::string& msg_type,
+                                        handler_type handler,
+                                        handler_policy policy)
+    {
+        std::lock_guard<std::mutex> lock(m_handler_mutex);
+        m_handler_storage.push_back(xhandler{handler, std::string(), nullptr, policy,
+                                             coalesce_status(msg_type)});
+        m_handler.insert(msg_type, &m_handler_storage.back());
+    }
+
+    void xkernel_core::register_request_handler(const std::string& msg_type,
+                                                const std::string& reply_type,
+                                                const xinterpreter::request_handler_type& handler)
+    {
+        std::lock_guard<std::mutex> lock(m_handler_mutex);
+        m_handler_storage.push_back(xhandler{nullptr, reply_type, handler, handler_policy::serial,
+                                             coalesce_status(msg_type)});
+        m_handler.insert(msg_type, &m_handler_storage.back());
+    }
+
+    bool xkernel_core::coalesce_status(const std::string& msg_type) const
+    {
+        return std::find(m_status_coalescing.cbegin(), m_status_coalescing.cend(), msg_type)
+            != m_status_coalescing.cend();
+    }
 
-        publish_status("idle");
+    auto xkernel_core::get_handler(const char* msg_type, std::size_t size) const -> const xhandler*
+    {
+        std::lock_guard<std::mutex> lock(m_handler_mutex);
+        const xhandler* const* res = m_handler.find(msg_type, size);
+        return res != nullptr ? *res : nullptr;
     }
 
-    auto xkernel_core::get_handler(const std::string& msg_type) -> handler_type
+    void xkernel_core::custom_request(const xmessage& request, const xhandler& handler, channel c)
     {
-        auto iter = m_handler.find(msg_type);
-        handler_type res = (iter == m_handler.end()) ? nullptr : iter->second;
-        return res;
+        xjson reply = handler.m_custom(request.content());
+        if (!handler.m_reply_type.empty())
+        {
+            send_reply(handler.m_reply_type, xjson::object(), std::move(reply), c);
+        }
     }
 
     void xkernel_core::interrupt_request(const xmessage& request, channel c) {
@@ -209,8 +439,8 @@ namespace xeus
 
             if (!silent && status == "error" && stop_on_error)
             {
-                long polling_interval = 50;
-                p_server->abort_queue(std::bind(&xkernel_core::abort_request, this, _1), 50);
+                p_server->abort_queue([this](zmq::multipart_t& wire_msg) { abort_request(wire_msg); },
+                                      abort_grace_period);
             }
         }
         catch (std::exception& e)
@@ -284,7 +514,7 @@ namespace xeus
             }
         }
         xjson reply;
-        reply["comms"] = comms;
+        reply["comms"] = std::move(comms);
         reply["status"] = "ok";
         send_reply("comm_info_reply", xjson::object(), std::move(reply), c);
     }
@@ -293,6 +523,10 @@ namespace xeus
     {
         xjson reply = p_interpreter->kernel_info_request();
         reply["protocol_version"] = get_protocol_version();
+        if (!m_iopub_compression.is_null())
+        {
+            reply["iopub_compression"] = m_iopub_compression;
+        }
         send_reply("kernel_info_reply", xjson::object(), std::move(reply), c);
     }
 
@@ -300,27 +534,73 @@ namespace xeus
     {
         const xjson& content = request.content();
         bool restart = content.value("restart", false);
-        p_server->stop();
         xjson reply;
         reply["restart"] = restart;
         publish_message("shutdown", xjson::object(), xjson(reply));
         send_reply("shutdown_reply", xjson::object(), std::move(reply), c);
+        // Stopping last, the shell thread may stop the channels as soon
+        // as it is notified when the request comes from the control thread.
+        if (restart && m_restart_in_process)
+        {
+            m_restart_requested = true;
+            p_server->restart();
+        }
+        else
+        {
+            p_server->stop();
+        }
     }
 
-    void xkernel_core::publish_status(const std::string& status)
+    void xkernel_core::publish_status(const xrequest_context& context,
+                                      const std::string& status)
     {
-        xjson content;
-        content["execution_state"] = status;
-        publish_message("status", xjson::object(), std::move(content));
+        publish_message(context, "status", xjson::object(),
+                        xjson_frame(make_status_content(status)));
+    }
+
+    void xkernel_core::publish_busy(const xrequest_context& context, channel c, bool coalesce)
+    {
+        if (!coalesce)
+        {
+            // Keeps the statuses in the order of the requests
+            if (c == channel::SHELL)
+            {
+                publish_deferred_idle();
+            }
+            publish_status(context, "busy");
+        }
+        else if (m_deferred_idle.empty())
+        {
+            publish_status(context, "busy");
+        }
+    }
+
+    void xkernel_core::publish_idle(const xrequest_context::pointer& context, bool coalesce)
+    {
+        if (coalesce)
+        {
+            m_deferred_idle.push_back(context);
+        }
+        else
+        {
+            publish_status(*context, "idle");
+        }
+    }
+
+    void xkernel_core::publish_deferred_idle()
+    {
+        for (const auto& context : m_deferred_idle)
+        {
+            publish_status(*context, "idle");
+        }
+        m_deferred_idle.clear();
     }
 
     void xkernel_core::publish_execute_input(const std::string& code,
                                              int execution_count)
     {
-        xjson content;
-        content["code"] = code;
-        content["execution_count"] = execution_count;
-        publish_message("execute_input", xjson::object(), std::move(content));
+        publish_message("execute_input", xjson::object(),
+                        xjson_frame(make_execute_input_content(code, execution_count)));
     }
 
     void xkernel_core::send_reply(const std::string& reply_type,
@@ -328,9 +608,18 @@ namespace xeus
                                   xjson reply_content,
                                   channel c)
     {
-        send_reply(get_parent_id(),
+        send_reply(current_request(), reply_type, std::move(metadata), std::move(reply_content), c);
+    }
+
+    void xkernel_core::send_reply(const xrequest_context& context,
+                                  const std::string& reply_type,
+                                  xjson metadata,
+                                  xjson reply_content,
+                                  channel c)
+    {
+        send_reply(context.id(),
                    reply_type,
-                   get_parent_header(),
+                   context.header(),
                    std::move(metadata),
                    std::move(reply_content),
                    c);
@@ -338,13 +627,13 @@ namespace xeus
 
     void xkernel_core::send_reply(const guid_list& id_list,
                                   const std::string& reply_type,
-                                  xjson parent_header,
+                                  xjson_frame parent_header,
                                   xjson metadata,
                                   xjson reply_content,
                                   channel c)
     {
         xmessage reply(id_list,
-                       make_header(reply_type, m_user_name, m_session_id),
+                       m_header_factory.make_header(reply_type),
                        std::move(parent_header),
                        std::move(metadata),
                        std::move(reply_content));
@@ -372,15 +661,23 @@ namespace xeus
             std::cerr << "ERROR: during execute_request: " << e.what() << std::endl;
             return;
         }
-        const xjson& header = msg.header();
-        std::string msg_type = header.value("msg_type", "");
+        // deserialize only checks the signature, the message type is then
+        // found in place in the header frame which is sent back as the
+        // parent header without being parsed.
+        std::string msg_type = msg.msg_type();
         // replace "_request" part of message type by "_reply"
-        msg_type.replace(msg_type.find_last_of('_'), 8, "_reply");
+        std::size_t suffix_pos = msg_type.find_last_of('_');
+        if (suffix_pos == std::string::npos)
+        {
+            std::cerr << "ERROR: cannot abort message of type " << msg_type << std::endl;
+            return;
+        }
+        msg_type.replace(suffix_pos, std::string::npos, "_reply");
         xjson content;
         content["status"] = "error";
         send_reply(msg.identities(),
                    msg_type,
-                   xjson(header),
+                   msg.header_frame(),
                    xjson::object(),
                    std::move(content),
                    channel::SHELL);
@@ -398,23 +695,6 @@ namespace xeus
         return metadata;
     }
 
-    void xkernel_core::set_parent(const guid_list& parent_id,
-                                  const xjson& parent_header)
-    {
-        m_parent_id = parent_id;
-        m_parent_header = xjson(parent_header);
-    }
-
-    const xkernel_core::guid_list& xkernel_core::get_parent_id() const
-    {
-        return m_parent_id;
-    }
-
-    xjson xkernel_core::get_parent_header() const
-    {
-        return m_parent_header;
-    }
-
     void xkernel_core::comm_open(const xmessage& request, channel)
     {
         return m_comm_manager.comm_open(request);
@@ -429,4 +709,91 @@ namespace xeus
     {
         return m_comm_manager.comm_msg(request);
     }
+
+    bool xkernel_core::comm_msg_batch(xmessage& request, context_list& batched, bool coalesce)
+    {
+        const xjson& content = request.content();
+        std::string comm_id = content.value("comm_id", "");
+
+        std::vector<xmessage> batch;
+        batch.push_back(std::move(request));
+
+        // Drains the comm_msgs for the same comm already queued on the
+        // shell channel. The first other message is kept in request.
+        bool has_next = false;
+        zmq::multipart_t wire_msg;
+        while (batch.size() < max_comm_batch_size && p_server->poll_shell(wire_msg))
+        {
+            xmessage next;
+            if (!deserialize(wire_msg, next))
+            {
+                wire_msg.clear();
+                continue;
+            }
+
+            bool same_comm = false;
+            try
+            {
+                same_comm = next.msg_type() == "comm_msg" &&
+                    next.content().value("comm_id", "") == comm_id;
+            }
+            catch (std::exception&)
+            {
+                // Malformed content, handled as any other request
+            }
+
+            if (same_comm)
+            {
+                batched.push_back(std::make_shared<const xrequest_context>(next));
+                if (!coalesce)
+                {
+                    publish_status(*batched.back(), "busy");
+                }
+                batch.push_back(std::move(next));
+            }
+            else
+            {
+                request = std::move(next);
+                has_next = true;
+                break;
+            }
+        }
+
+        xcomm* comm = m_comm_manager.comms().find(comm_id.c_str(), comm_id.size());
+        if (comm != nullptr && !comm->has_batch_handler())
+        {
+            // Each message is handled in the scope of its own request,
+            // which is the parent of its replies and outputs. The scope
+            // of the first one is set by handle_request.
+            for (std::size_t i = 0; i < batch.size(); ++i)
+            {
+                std::unique_ptr<xrequest_scope> scope;
+                if (i != 0)
+                {
+                    scope.reset(new xrequest_scope(*batched[i - 1]));
+                }
+                try
+                {
+                    m_comm_manager.comm_msg(batch[i]);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "ERROR: received bad message: " << e.what() << std::endl;
+                    std::cerr << "Message content: " << batch[i].content() << std::endl;
+                }
+            }
+            return has_next;
+        }
+
+        try
+        {
+            m_comm_manager.comm_msg_batch(batch);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "ERROR: received bad message: " << e.what() << std::endl;
+            std::cerr << "Message content: " << batch.front().content() << std::endl;
+        }
+        return has_next;
+    }
 }
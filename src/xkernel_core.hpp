@@ -9,13 +9,22 @@
 #ifndef XKERNEL_CORE_HPP
 #define XKERNEL_CORE_HPP
 
-#include <map>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "xeus/xcomm.hpp"
 #include "xeus/xserver.hpp"
 #include "xeus/xinterpreter.hpp"
 #include "xeus/xauthentication.hpp"
 #include "xeus/xmessage.hpp"
+#include "xdispatch_table.hpp"
+#include "xheader_factory.hpp"
+#include "xrequest_context.hpp"
+#include "xthread_pool.hpp"
 
 namespace xeus
 {
@@ -33,15 +42,21 @@ namespace xeus
                      const std::string& session_id,
                      authentication_ptr auth,
                      server_ptr server,
-                     interpreter_ptr p_interpreter);
+                     interpreter_ptr p_interpreter,
+                     const std::vector<std::string>& status_coalescing = std::vector<std::string>(),
+                     bool restart_in_process = false,
+                     xjson iopub_compression = xjson());
 
         void dispatch_shell(zmq::multipart_t& wire_msg);
         void dispatch_control(zmq::multipart_t& wire_msg);
         void dispatch_stdin(zmq::multipart_t& wire_msg);
 
+        using buffer_sequence = xmessage::buffer_sequence;
+
         void publish_message(const std::string& msg_type,
                              xjson metadata,
-                             xjson content);
+                             xjson_frame content,
+                             buffer_sequence buffers = buffer_sequence());
 
         void send_stdin(const std::string& msg_type,
                         xjson metadata,
@@ -51,6 +66,9 @@ namespace xeus
         const xcomm_manager& comm_manager() const & noexcept;
         xcomm_manager comm_manager() const && noexcept;
 
+        // True if the server has been restarted by a shutdown_request
+        bool restart_requested() const noexcept;
+
     private:
 
         enum class channel
@@ -62,9 +80,50 @@ namespace xeus
         using handler_type = void (xkernel_core::*)(const xmessage&, xkernel_core::channel);
         using guid_list = xmessage::guid_list;
 
-        void dispatch(zmq::multipart_t& wire_msg, channel c);
+        // serial: never runs concurrently with another request.
+        // lock_free: may run on the control thread while the shell is busy.
+        // concurrent: runs on the worker pool if the interpreter supports
+        // concurrent requests, serial otherwise.
+        enum class handler_policy
+        {
+            serial,
+            lock_free,
+            concurrent
+        };
 
-        handler_type get_handler(const std::string& msg_type);
+        // Either a member handler, or a handler registered by
+        // the interpreter when m_member is null.
+        struct xhandler
+        {
+            handler_type m_member;
+            std::string m_reply_type;
+            xinterpreter::request_handler_type m_custom;
+            handler_policy m_policy;
+            bool m_coalesce_status;
+        };
+
+        using context_list = std::vector<xrequest_context::pointer>;
+
+        void dispatch(zmq::multipart_t& wire_msg, channel c);
+        bool deserialize(zmq::multipart_t& wire_msg, xmessage& msg) const;
+        // Returns true if msg has been replaced by a request
+        // which must be handled next.
+        bool handle_request(xmessage& msg, channel c);
+
+        void register_handler(const std::string& msg_type,
+                              handler_type handler,
+                              handler_policy policy = handler_policy::serial);
+        void register_request_handler(const std::string& msg_type,
+                                      const std::string& reply_type,
+                                      const xinterpreter::request_handler_type& handler);
+        const xhandler* get_handler(const char* msg_type, std::size_t size) const;
+        bool coalesce_status(const std::string& msg_type) const;
+
+        void run_handler(const xhandler* handler, const xmessage& request, channel c);
+        void submit_request(const xhandler* handler,
+                            xmessage request,
+                            xrequest_context::pointer context);
+        void custom_request(const xmessage& request, const xhandler& handler, channel c);
 
         void interrupt_request(const xmessage& request, channel c);
         void execute_request(const xmessage& request, channel c);
@@ -76,23 +135,47 @@ namespace xeus
         void comm_open(const xmessage& request, channel c);
         void comm_close(const xmessage& request, channel c);
         void comm_msg(const xmessage& request, channel c);
+        // The contexts of the requests merged into the batch are
+        // appended to batched, their busy status is published unless
+        // the statuses are coalesced.
+        bool comm_msg_batch(xmessage& request, context_list& batched, bool coalesce);
 
         void kernel_info_request(const xmessage& request, channel c);
         void shutdown_request(const xmessage& request, channel c);
 
-        void publish_status(const std::string& status);
+        void publish_message(const xrequest_context& context,
+                             const std::string& msg_type,
+                             xjson metadata,
+                             xjson_frame content,
+                             buffer_sequence buffers = buffer_sequence());
+
+        void publish_status(const xrequest_context& context,
+                            const std::string& status);
+
+        // Busy is skipped when coalescing while idle statuses are
+        // deferred, idle is then deferred too.
+        void publish_busy(const xrequest_context& context, channel c, bool coalesce);
+        void publish_idle(const xrequest_context::pointer& context, bool coalesce);
+        void publish_deferred_idle();
 
         void publish_execute_input(const std::string& code,
                                    int execution_count);
 
+        // Replies to the request handled by the current thread
         void send_reply(const std::string& reply_type,
                         xjson metadata,
                         xjson reply_content,
                         channel c);
 
+        void send_reply(const xrequest_context& context,
+                        const std::string& reply_type,
+                        xjson metadata,
+                        xjson reply_content,
+                        channel c);
+
         void send_reply(const guid_list& id_list,
                         const std::string& reply_type,
-                        xjson parent_header,
+                        xjson_frame parent_header,
                         xjson metadata,
                         xjson reply_content,
                         channel c);
@@ -102,23 +185,37 @@ namespace xeus
         std::string get_topic(const std::string& msg_type) const;
         xjson get_metadata() const;
 
-        void set_parent(const guid_list& list,
-                        const xjson& parent);
-        const guid_list& get_parent_id() const;
-        xjson get_parent_header() const;
 
         std::string m_kernel_id;
         std::string m_user_name;
         std::string m_session_id;
+        xheader_factory m_header_factory;
         authentication_ptr p_auth;
 
-        std::map<std::string, handler_type> m_handler;
+        // Handlers may be registered while requests are dispatched on the
+        // shell and control threads (e.g. by an interpreter configured in
+        // the background). The table is guarded by m_handler_mutex, the
+        // handlers themselves are never moved nor destroyed, so that the
+        // pointers returned by get_handler remain valid.
+        xdispatch_table<const xhandler*> m_handler;
+        std::deque<xhandler> m_handler_storage;
+        mutable std::mutex m_handler_mutex;
         xcomm_manager m_comm_manager;
         server_ptr p_server;
         interpreter_ptr p_interpreter;
 
-        guid_list m_parent_id;
-        xjson m_parent_header;
+        std::vector<std::string> m_status_coalescing;
+        // Only accessed from the shell thread
+        context_list m_deferred_idle;
+
+        bool m_restart_in_process;
+        bool m_restart_requested;
+        // Added to the kernel_info_reply when not null
+        xjson m_iopub_compression;
+
+        std::mutex m_dispatch_mutex;
+        // Created on the first concurrent request
+        std::unique_ptr<xthread_pool> p_worker_pool;
     };
 
 }
@@ -0,0 +1,53 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <utility>
+
+#include "xeus/xkernel_host.hpp"
+#include "xeus/make_unique.hpp"
+#include "xserver_impl.hpp"
+#include "xserver_pump.hpp"
+
+namespace xeus
+{
+
+    xkernel_host::xkernel_host(int io_threads)
+        : m_context(io_threads),
+          p_pump(::xeus::make_unique<xserver_pump>(m_context))
+    {
+    }
+
+    xkernel_host::~xkernel_host()
+    {
+        join();
+    }
+
+    void xkernel_host::start(xkernel& kernel)
+    {
+        xkernel::server_ptr server = ::xeus::make_unique<xserver_impl>(m_context,
+                                                                       kernel.configuration(),
+                                                                       nullptr,
+                                                                       p_pump.get());
+        // The server is built on the calling thread so that errors
+        // binding its sockets are reported to the caller.
+        m_kernel_threads.emplace_back([this, &kernel](xkernel::server_ptr s)
+        {
+            kernel.start(m_context, std::move(s));
+        }, std::move(server));
+    }
+
+    void xkernel_host::join()
+    {
+        for (auto& t : m_kernel_threads)
+        {
+            t.join();
+        }
+        m_kernel_threads.clear();
+    }
+
+}
@@ -0,0 +1,170 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XMAC_POOL_HPP
+#define XMAC_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace xeus
+{
+
+    /**
+     * @class xmac_pool
+     * @brief Pool of keyed message authentication contexts.
+     *
+     * Contexts are keyed once at construction. Acquiring a context does not
+     * lock: each thread starts probing at a slot derived from its id, so
+     * concurrent producers usually get distinct contexts on the first try.
+     * When every slot is busy, a temporary context is keyed on the fly.
+     * M must be constructible from a key buffer and its size, and must
+     * restart with the same key after Final or Restart (as CryptoPP
+     * MACs do). Contexts are returned to the pool as they are, their
+     * users restart the ones they have not finalized.
+     */
+    template <class M>
+    class xmac_pool
+    {
+    public:
+
+        using mac_type = M;
+
+        class handle
+        {
+        public:
+
+            handle(const handle&) = delete;
+            handle& operator=(const handle&) = delete;
+
+            handle(handle&& rhs);
+            handle& operator=(handle&&) = delete;
+
+            ~handle();
+
+            mac_type& operator*() const noexcept;
+            mac_type* operator->() const noexcept;
+
+        private:
+
+            friend class xmac_pool;
+
+            handle(mac_type* mac, std::atomic<bool>* busy);
+            explicit handle(std::unique_ptr<mac_type> mac);
+
+            std::unique_ptr<mac_type> p_owned;
+            mac_type* p_mac;
+            std::atomic<bool>* p_busy;
+        };
+
+        xmac_pool(const std::string& key, std::size_t size);
+
+        handle acquire() const;
+
+    private:
+
+        struct slot
+        {
+            explicit slot(const std::string& key);
+
+            mac_type m_mac;
+            std::atomic<bool> m_busy;
+        };
+
+        std::string m_key;
+        std::size_t m_size;
+        std::unique_ptr<std::unique_ptr<slot>[]> m_slots;
+    };
+
+    /*******************************
+     * xmac_pool<M> implementation *
+     *******************************/
+
+    template <class M>
+    inline xmac_pool<M>::handle::handle(mac_type* mac, std::atomic<bool>* busy)
+        : p_owned(), p_mac(mac), p_busy(busy)
+    {
+    }
+
+    template <class M>
+    inline xmac_pool<M>::handle::handle(std::unique_ptr<mac_type> mac)
+        : p_owned(std::move(mac)), p_mac(p_owned.get()), p_busy(nullptr)
+    {
+    }
+
+    template <class M>
+    inline xmac_pool<M>::handle::handle(handle&& rhs)
+        : p_owned(std::move(rhs.p_owned)), p_mac(rhs.p_mac), p_busy(rhs.p_busy)
+    {
+        rhs.p_mac = nullptr;
+        rhs.p_busy = nullptr;
+    }
+
+    template <class M>
+    inline xmac_pool<M>::handle::~handle()
+    {
+        if (p_busy != nullptr)
+        {
+            p_busy->store(false, std::memory_order_release);
+        }
+    }
+
+    template <class M>
+    inline auto xmac_pool<M>::handle::operator*() const noexcept -> mac_type&
+    {
+        return *p_mac;
+    }
+
+    template <class M>
+    inline auto xmac_pool<M>::handle::operator->() const noexcept -> mac_type*
+    {
+        return p_mac;
+    }
+
+    template <class M>
+    inline xmac_pool<M>::slot::slot(const std::string& key)
+        : m_mac(reinterpret_cast<const unsigned char*>(key.c_str()), key.size()),
+          m_busy(false)
+    {
+    }
+
+    template <class M>
+    inline xmac_pool<M>::xmac_pool(const std::string& key, std::size_t size)
+        : m_key(key),
+          m_size(size == 0 ? 1 : size),
+          m_slots(new std::unique_ptr<slot>[m_size])
+    {
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            m_slots[i].reset(new slot(m_key));
+        }
+    }
+
+    template <class M>
+    inline auto xmac_pool<M>::acquire() const -> handle
+    {
+        std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_size;
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            slot& s = *m_slots[(start + i) % m_size];
+            if (!s.m_busy.load(std::memory_order_relaxed) &&
+                !s.m_busy.exchange(true, std::memory_order_acquire))
+            {
+                return handle(&s.m_mac, &s.m_busy);
+            }
+        }
+        std::unique_ptr<mac_type> mac(new mac_type(reinterpret_cast<const unsigned char*>(m_key.c_str()), m_key.size()));
+        return handle(std::move(mac));
+    }
+}
+
+#endif
@@ -6,10 +6,20 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
 
 #include "xeus/xguid.hpp"
 #include "xeus/xmessage.hpp"
+#include "xbuffer_pool.hpp"
+#include "xmessage_utils.hpp"
+#include "xmetrics.hpp"
+#include "xtimestamp.hpp"
 
 namespace xeus
 {
@@ -23,20 +33,227 @@ namespace xeus
         json = xjson::parse(buf, buf + msg.size());
     }
 
+    // Frames up to this size are stored inline in zmq::message_t,
+    // copying them is cheaper than handing over the buffer.
+    constexpr std::size_t zero_copy_threshold = 32;
+
+    void release_zmq_buffer(void* /*data*/, void* hint)
+    {
+        get_serialization_pool().release(xbuffer_pool::buffer_ptr(static_cast<std::string*>(hint)));
+    }
+
+    namespace
+    {
+        // Appends the characters written to a string, whose
+        // capacity is reused instead of building a new one.
+        class xstring_buffer : public std::streambuf
+        {
+        public:
+
+            explicit xstring_buffer(std::string& out)
+                : m_out(out)
+            {
+            }
+
+        protected:
+
+            int_type overflow(int_type c) override
+            {
+                if (!traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    m_out.push_back(traits_type::to_char_type(c));
+                }
+                return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn(const char* s, std::streamsize n) override
+            {
+                m_out.append(s, static_cast<std::size_t>(n));
+                return n;
+            }
+
+        private:
+
+            std::string& m_out;
+        };
+    }
+
+    // Same output as json.dump(), written into a recycled buffer. The
+    // stream output operator is the public entry point of the xjson
+    // serializer, without width it writes the compact form.
+    void dump_json(const xjson& json, std::string& out)
+    {
+        xstring_buffer buffer(out);
+        std::ostream stream(&buffer);
+        stream << json;
+    }
+
     zmq::message_t write_zmq_message(const xjson& json)
     {
-        std::string buffer = json.dump();
-        return zmq::message_t(buffer.c_str(), buffer.size());
+        xbuffer_pool& pool = get_serialization_pool();
+        xbuffer_pool::buffer_ptr buffer = pool.acquire();
+        dump_json(json, *buffer);
+        std::size_t size = buffer->size();
+        if (size <= zero_copy_threshold)
+        {
+            zmq::message_t res(buffer->c_str(), size);
+            pool.release(std::move(buffer));
+            return res;
+        }
+
+        // The message takes ownership of the buffer, which is given back
+        // to the pool by ZeroMQ once the frame has been sent.
+        zmq::message_t res(&(*buffer)[0], size, release_zmq_buffer, buffer.get());
+        buffer.release();
+        return res;
+    }
+
+    bool find_string_value(const zmq::message_t& msg,
+                           const char* key,
+                           const char*& value,
+                           std::size_t& size)
+    {
+        const char* begin = msg.data<const char>();
+        const char* end = begin + msg.size();
+        std::size_t key_size = std::strlen(key);
+
+        auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+        const char* iter = begin;
+        while ((iter = std::find(iter, end, '"')) != end)
+        {
+            const char* pos = iter + 1;
+            if (static_cast<std::size_t>(end - pos) <= key_size ||
+                std::memcmp(pos, key, key_size) != 0 || pos[key_size] != '"')
+            {
+                iter = pos;
+                continue;
+            }
+            pos += key_size + 1;
+            while (pos != end && is_space(*pos))
+                ++pos;
+            if (pos != end && *pos == ':')
+            {
+                ++pos;
+                while (pos != end && is_space(*pos))
+                    ++pos;
+                if (pos == end || *pos != '"')
+                    return false;
+                const char* value_begin = ++pos;
+                while (pos != end && *pos != '"')
+                {
+                    // Escaped characters are left to the JSON parser
+                    if (*pos == '\\')
+                        return false;
+                    ++pos;
+                }
+                if (pos == end)
+                    return false;
+                value = value_begin;
+                size = static_cast<std::size_t>(pos - value_begin);
+                return true;
+            }
+            iter = pos;
+        }
+        return false;
+    }
+
+    xjson_frame::xjson_frame()
+        : xjson_frame(xjson())
+    {
+    }
+
+    xjson_frame::xjson_frame(xjson value)
+        : m_value(std::move(value)),
+          m_frame(),
+          m_parsed(true),
+          m_has_frame(false)
+    {
+    }
+
+    xjson_frame::xjson_frame(zmq::message_t frame)
+        : m_value(),
+          m_frame(std::move(frame)),
+          m_parsed(false),
+          m_has_frame(true)
+    {
+    }
+
+    xjson_frame::xjson_frame(const xjson_frame& rhs)
+        : m_value(),
+          m_frame(),
+          m_parsed(!rhs.m_has_frame),
+          m_has_frame(rhs.m_has_frame)
+    {
+        if (m_has_frame)
+        {
+            // Shares the frame, the copy will be parsed on demand
+            m_frame.copy(&rhs.m_frame);
+        }
+        else
+        {
+            m_value = rhs.m_value;
+        }
+    }
+
+    xjson_frame& xjson_frame::operator=(const xjson_frame& rhs)
+    {
+        xjson_frame tmp(rhs);
+        *this = std::move(tmp);
+        return *this;
+    }
+
+    const xjson& xjson_frame::get() const
+    {
+        if (!m_parsed)
+        {
+            parse_zmq_message(m_frame, m_value);
+            m_parsed = true;
+        }
+        return m_value;
+    }
+
+    xjson& xjson_frame::get_mutable()
+    {
+        get();
+        if (m_has_frame)
+        {
+            m_frame.rebuild();
+            m_has_frame = false;
+        }
+        return m_value;
     }
 
-    xmessage_base::xmessage_base(xjson header,
-                                 xjson parent_header,
-                                 xjson metadata,
-                                 xjson content)
+    bool xjson_frame::has_frame() const noexcept
+    {
+        return m_has_frame;
+    }
+
+    const zmq::message_t& xjson_frame::frame() const noexcept
+    {
+        return m_frame;
+    }
+
+    zmq::message_t xjson_frame::serialize() const
+    {
+        if (m_has_frame)
+        {
+            zmq::message_t res;
+            res.copy(&m_frame);
+            return res;
+        }
+        return write_zmq_message(m_value);
+    }
+
+    xmessage_base::xmessage_base(xjson_frame header,
+                                 xjson_frame parent_header,
+                                 xjson_frame metadata,
+                                 xjson_frame content,
+                                 buffer_sequence buffers)
         : m_header(std::move(header)),
           m_parent_header(std::move(parent_header)),
           m_metadata(std::move(metadata)),
-          m_content(std::move(content))
+          m_content(std::move(content)),
+          m_buffers(std::move(buffers))
     {
     }
 
@@ -52,6 +269,7 @@ namespace xeus
 
     void xmessage_base::deserialize(zmq::multipart_t& wire_msg, const xauthentication& auth)
     {
+        XEUS_METRICS_TIME(m_deserialize);
         zmq::message_t signature = wire_msg.pop();
         zmq::message_t header = wire_msg.pop();
         zmq::message_t parent_header = wire_msg.pop();
@@ -61,59 +279,130 @@ namespace xeus
         if (!auth.verify(signature, header, parent_header, metadata, content))
             throw std::runtime_error("Signatures don't match");
 
-        parse_zmq_message(header, m_header);
-        parse_zmq_message(parent_header, m_parent_header);
-        parse_zmq_message(metadata, m_metadata);
-        parse_zmq_message(content, m_content);
+        // Parts are parsed on first access only
+        m_header = xjson_frame(std::move(header));
+        m_parent_header = xjson_frame(std::move(parent_header));
+        m_metadata = xjson_frame(std::move(metadata));
+        m_content = xjson_frame(std::move(content));
+
+        m_buffers.clear();
+        while (wire_msg.size() != 0)
+        {
+            m_buffers.push_back(wire_msg.pop());
+        }
     }
 
     void xmessage_base::serialize(zmq::multipart_t& wire_msg, const xauthentication& auth) const
     {
+        XEUS_METRICS_TIME(m_serialize);
         // DELIMITER is written in the inheriting class so serialize/ deserialize
         // are symmetric
 
-        zmq::message_t header = write_zmq_message(m_header);
-        zmq::message_t parent_header = write_zmq_message(m_parent_header);
-        zmq::message_t metadata = write_zmq_message(m_metadata);
-        zmq::message_t content = write_zmq_message(m_content);
-        zmq::message_t signature = auth.sign(header, parent_header, metadata, content);
+        // Each part is signed right after being serialized, while
+        // it is still in cache.
+        std::unique_ptr<xsigner> signer = auth.make_signer();
+        zmq::message_t header = m_header.serialize();
+        signer->update(header);
+        zmq::message_t parent_header = m_parent_header.serialize();
+        signer->update(parent_header);
+        zmq::message_t metadata = m_metadata.serialize();
+        signer->update(metadata);
+        zmq::message_t content = m_content.serialize();
+        signer->update(content);
+        zmq::message_t signature = signer->final();
 
         wire_msg.add(std::move(signature));
         wire_msg.add(std::move(header));
         wire_msg.add(std::move(parent_header));
         wire_msg.add(std::move(metadata));
         wire_msg.add(std::move(content));
+
+        // Buffers are shared with the message, not copied
+        for (const auto& buffer : m_buffers)
+        {
+            zmq::message_t frame;
+            frame.copy(&buffer);
+            wire_msg.add(std::move(frame));
+        }
     }
 
     const xjson& xmessage_base::header() const
     {
-        return m_header;
+        return m_header.get();
     }
 
     const xjson& xmessage_base::parent_header() const
     {
-        return m_parent_header;
+        return m_parent_header.get();
     }
 
     const xjson& xmessage_base::metadata() const
     {
-        return m_metadata;
+        return m_metadata.get();
     }
 
     const xjson& xmessage_base::content() const
+    {
+        return m_content.get();
+    }
+
+    auto xmessage_base::buffers() const -> const buffer_sequence&
+    {
+        return m_buffers;
+    }
+
+    const xjson_frame& xmessage_base::header_frame() const
+    {
+        return m_header;
+    }
+
+    const xjson_frame& xmessage_base::parent_header_frame() const
+    {
+        return m_parent_header;
+    }
+
+    const xjson_frame& xmessage_base::metadata_frame() const
+    {
+        return m_metadata;
+    }
+
+    const xjson_frame& xmessage_base::content_frame() const
     {
         return m_content;
     }
 
+    xjson& xmessage_base::mutable_content()
+    {
+        return m_content.get_mutable();
+    }
+
+    std::string xmessage_base::msg_type() const
+    {
+        const char* data;
+        std::size_t size;
+        if (raw_msg_type(data, size))
+        {
+            return std::string(data, size);
+        }
+        return header().value("msg_type", "");
+    }
+
+    bool xmessage_base::raw_msg_type(const char*& data, std::size_t& size) const
+    {
+        return m_header.has_frame() && find_string_value(m_header.frame(), "msg_type", data, size);
+    }
+
     xmessage::xmessage(const guid_list& zmq_id,
-                       xjson header,
-                       xjson parent_header,
-                       xjson metadata,
-                       xjson content)
+                       xjson_frame header,
+                       xjson_frame parent_header,
+                       xjson_frame metadata,
+                       xjson_frame content,
+                       buffer_sequence buffers)
         : xmessage_base(std::move(header),
             std::move(parent_header),
             std::move(metadata),
-            std::move(content)),
+            std::move(content),
+            std::move(buffers)),
         m_zmq_id(zmq_id)
     {
     }
@@ -153,14 +442,16 @@ namespace xeus
     }
 
     xpub_message::xpub_message(const std::string& topic,
-                               xjson header,
-                               xjson parent_header,
-                               xjson metadata,
-                               xjson content)
+                               xjson_frame header,
+                               xjson_frame parent_header,
+                               xjson_frame metadata,
+                               xjson_frame content,
+                               buffer_sequence buffers)
         : xmessage_base(std::move(header),
                         std::move(parent_header),
                         std::move(metadata),
-                        std::move(content)),
+                        std::move(content),
+                        std::move(buffers)),
         m_topic(topic)
     {
     }
@@ -185,13 +476,24 @@ namespace xeus
         return m_topic;
     }
 
+    void release_buffer_owner(void* /*data*/, void* hint)
+    {
+        delete static_cast<std::shared_ptr<const void>*>(hint);
+    }
+
+    zmq::message_t make_buffer(const void* data,
+                               std::size_t size,
+                               std::shared_ptr<const void> owner)
+    {
+        std::unique_ptr<std::shared_ptr<const void>> hint(new std::shared_ptr<const void>(std::move(owner)));
+        zmq::message_t res(const_cast<void*>(data), size, release_buffer_owner, hint.get());
+        hint.release();
+        return res;
+    }
+
     std::string iso8601_now()
     {
-        std::time_t now;
-        std::time(&now);
-        char buffer[sizeof "2016-12-02T15:10:00Z"];
-        std::strftime(buffer, sizeof buffer, "%FT%TZ", std::gmtime(&now));
-        return std::string(buffer, buffer + sizeof buffer);
+        return std::string(iso8601_timestamp(), iso8601_size);
     }
 
     std::string get_protocol_version()
@@ -204,7 +506,7 @@ namespace xeus
                       const std::string& session_id)
     {
         xjson header;
-        header["msg_id"] = new_xguid();
+        header["msg_id"] = new_time_ordered_xguid();
         header["username"] = user_name;
         header["session"] = session_id;
         header["date"] = iso8601_now();
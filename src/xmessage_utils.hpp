@@ -0,0 +1,32 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XMESSAGE_UTILS_HPP
+#define XMESSAGE_UTILS_HPP
+
+#include <cstddef>
+
+#include "zmq.hpp"
+
+namespace xeus
+{
+    // Looks for "key": "value" in a serialized JSON object without parsing
+    // it. On success, value and size refer to the characters of the value
+    // inside msg. Returns false if the key is not found or if the value is
+    // not a plain string, so the caller can fall back to a full parse.
+    bool find_string_value(const zmq::message_t& msg,
+                           const char* key,
+                           const char*& value,
+                           std::size_t& size);
+
+    // Deallocation function of the frames built from buffers of the
+    // serialization pool, the hint is the buffer.
+    void release_zmq_buffer(void* data, void* hint);
+}
+
+#endif
@@ -0,0 +1,302 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include "xmetrics.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        std::size_t most_significant_bit(std::uint64_t value) noexcept
+        {
+            std::size_t res = 0;
+            while (value >>= 1)
+            {
+                ++res;
+            }
+            return res;
+        }
+
+        // FNV-1a
+        std::size_t hash_name(const char* name, std::size_t size) noexcept
+        {
+            std::uint64_t res = 14695981039346656037ULL;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                res ^= static_cast<unsigned char>(name[i]);
+                res *= 1099511628211ULL;
+            }
+            return static_cast<std::size_t>(res);
+        }
+
+        // Bounds of the Prometheus buckets, in nanoseconds: powers of
+        // two from about 1us to about 17s. They are bucket boundaries
+        // of xhistogram, the cumulative counts are therefore exact.
+        constexpr std::size_t prometheus_min_shift = 10;
+        constexpr std::size_t prometheus_max_shift = 34;
+
+        void format_histogram(std::ostringstream& os,
+                              const std::string& stage,
+                              const xhistogram_snapshot& histogram)
+        {
+            auto iter = histogram.m_buckets.cbegin();
+            std::uint64_t cumulative = 0;
+            for (std::size_t shift = prometheus_min_shift; shift <= prometheus_max_shift; ++shift)
+            {
+                std::uint64_t bound = std::uint64_t(1) << shift;
+                for (; iter != histogram.m_buckets.cend() && iter->first <= bound; ++iter)
+                {
+                    cumulative += iter->second;
+                }
+                os << "xeus_latency_seconds_bucket{stage=\"" << stage << "\",le=\""
+                   << static_cast<double>(bound) * 1e-9 << "\"} " << cumulative << '\n';
+            }
+            os << "xeus_latency_seconds_bucket{stage=\"" << stage << "\",le=\"+Inf\"} "
+               << histogram.m_count << '\n';
+            os << "xeus_latency_seconds_sum{stage=\"" << stage << "\"} "
+               << static_cast<double>(histogram.m_sum) * 1e-9 << '\n';
+            os << "xeus_latency_seconds_count{stage=\"" << stage << "\"} "
+               << histogram.m_count << '\n';
+        }
+    }
+
+    /***************************************
+     * xhistogram_snapshot implementation *
+     ***************************************/
+
+    std::uint64_t xhistogram_snapshot::percentile(double p) const
+    {
+        if (m_count == 0)
+        {
+            return 0;
+        }
+        double clamped = p < 0. ? 0. : (p > 100. ? 100. : p);
+        std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(clamped / 100. * static_cast<double>(m_count)));
+        rank = rank == 0 ? 1 : rank;
+        std::uint64_t cumulative = 0;
+        for (const auto& bucket : m_buckets)
+        {
+            cumulative += bucket.second;
+            if (cumulative >= rank)
+            {
+                return bucket.first;
+            }
+        }
+        return m_buckets.empty() ? 0 : m_buckets.back().first;
+    }
+
+    /*****************************
+     * xhistogram implementation *
+     *****************************/
+
+    constexpr std::size_t xhistogram::sub_bucket_count;
+    constexpr std::size_t xhistogram::bucket_count;
+
+    xhistogram::xhistogram()
+        : m_count(0), m_sum(0)
+    {
+        for (std::size_t i = 0; i < bucket_count; ++i)
+        {
+            m_buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void xhistogram::record(std::uint64_t value) noexcept
+    {
+        m_buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    xhistogram_snapshot xhistogram::snapshot() const
+    {
+        // Buckets are read one by one while being updated, the
+        // snapshot is consistent within the recorded precision only.
+        xhistogram_snapshot res;
+        for (std::size_t i = 0; i < bucket_count; ++i)
+        {
+            std::uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+            if (count != 0)
+            {
+                res.m_buckets.emplace_back(bucket_upper_bound(i), count);
+                res.m_count += count;
+            }
+        }
+        res.m_sum = m_sum.load(std::memory_order_relaxed);
+        return res;
+    }
+
+    std::size_t xhistogram::bucket_index(std::uint64_t value) noexcept
+    {
+        if (value < sub_bucket_count)
+        {
+            return static_cast<std::size_t>(value);
+        }
+        std::size_t msb = most_significant_bit(value);
+        std::size_t sub = static_cast<std::size_t>(value >> (msb - 3)) & (sub_bucket_count - 1);
+        return (msb - 2) * sub_bucket_count + sub;
+    }
+
+    std::uint64_t xhistogram::bucket_upper_bound(std::size_t index) noexcept
+    {
+        if (index < sub_bucket_count)
+        {
+            return index + 1;
+        }
+        std::size_t msb = index / sub_bucket_count + 2;
+        std::uint64_t sub = index % sub_bucket_count;
+        if (msb == 63 && sub == sub_bucket_count - 1)
+        {
+            return std::numeric_limits<std::uint64_t>::max();
+        }
+        return (sub_bucket_count + sub + 1) << (msb - 3);
+    }
+
+    /*********************************
+     * xcounter_table implementation *
+     *********************************/
+
+    constexpr std::size_t xcounter_table::slot_count;
+    constexpr std::size_t xcounter_table::max_name_size;
+
+    xcounter_table::xcounter_table()
+        : m_other(0)
+    {
+        for (std::size_t i = 0; i < slot_count; ++i)
+        {
+            m_slots[i].m_state.store(empty, std::memory_order_relaxed);
+            m_slots[i].m_size = 0;
+            m_slots[i].m_count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void xcounter_table::increment(const char* name, std::size_t size) noexcept
+    {
+        if (size >= max_name_size)
+        {
+            m_other.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::size_t start = hash_name(name, size) % slot_count;
+        for (std::size_t i = 0; i < slot_count; ++i)
+        {
+            slot& s = m_slots[(start + i) % slot_count];
+            int state = s.m_state.load(std::memory_order_acquire);
+            if (state == empty)
+            {
+                if (s.m_state.compare_exchange_strong(state, writing, std::memory_order_acquire))
+                {
+                    std::memcpy(s.m_name, name, size);
+                    s.m_size = size;
+                    s.m_count.fetch_add(1, std::memory_order_relaxed);
+                    s.m_state.store(ready, std::memory_order_release);
+                    return;
+                }
+            }
+            // Another thread is registering a name in this slot
+            while (state == writing)
+            {
+                std::this_thread::yield();
+                state = s.m_state.load(std::memory_order_acquire);
+            }
+            if (s.m_size == size && std::memcmp(s.m_name, name, size) == 0)
+            {
+                s.m_count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        m_other.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void xcounter_table::snapshot(std::map<std::string, std::uint64_t>& counters) const
+    {
+        for (std::size_t i = 0; i < slot_count; ++i)
+        {
+            const slot& s = m_slots[i];
+            if (s.m_state.load(std::memory_order_acquire) == ready)
+            {
+                counters[std::string(s.m_name, s.m_size)] = s.m_count.load(std::memory_order_relaxed);
+            }
+        }
+        std::uint64_t other = m_other.load(std::memory_order_relaxed);
+        if (other != 0)
+        {
+            counters["other"] = other;
+        }
+    }
+
+    /************************************
+     * xmetrics_registry implementation *
+     ************************************/
+
+    xmetrics_registry::xmetrics_registry()
+        : m_publish_queue_depth(0)
+    {
+    }
+
+    xmetrics_registry& get_metrics_registry()
+    {
+        static xmetrics_registry registry;
+        return registry;
+    }
+
+    xmetrics_snapshot get_metrics()
+    {
+        xmetrics_snapshot res;
+#ifdef XEUS_ENABLE_METRICS
+        xmetrics_registry& registry = get_metrics_registry();
+        res.m_enabled = true;
+        registry.m_requests.snapshot(res.m_requests);
+        res.m_latencies["deserialize"] = registry.m_deserialize.snapshot();
+        res.m_latencies["handler"] = registry.m_handler.snapshot();
+        res.m_latencies["serialize"] = registry.m_serialize.snapshot();
+        res.m_latencies["send"] = registry.m_send.snapshot();
+        res.m_latencies["sign"] = registry.m_sign.snapshot();
+        res.m_latencies["verify"] = registry.m_verify.snapshot();
+        res.m_gauges["publish_queue_depth"] = registry.m_publish_queue_depth.load(std::memory_order_relaxed);
+#endif
+        return res;
+    }
+
+    std::string format_prometheus(const xmetrics_snapshot& metrics)
+    {
+        std::ostringstream os;
+        if (!metrics.m_requests.empty())
+        {
+            os << "# HELP xeus_requests_total Requests handled by the kernel.\n";
+            os << "# TYPE xeus_requests_total counter\n";
+            for (const auto& counter : metrics.m_requests)
+            {
+                os << "xeus_requests_total{msg_type=\"" << counter.first << "\"} "
+                   << counter.second << '\n';
+            }
+        }
+        if (!metrics.m_latencies.empty())
+        {
+            os << "# HELP xeus_latency_seconds Time spent in each stage of message processing.\n";
+            os << "# TYPE xeus_latency_seconds histogram\n";
+            for (const auto& histogram : metrics.m_latencies)
+            {
+                format_histogram(os, histogram.first, histogram.second);
+            }
+        }
+        for (const auto& gauge : metrics.m_gauges)
+        {
+            os << "# TYPE xeus_" << gauge.first << " gauge\n";
+            os << "xeus_" << gauge.first << ' ' << gauge.second << '\n';
+        }
+        return os.str();
+    }
+}
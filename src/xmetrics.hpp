@@ -0,0 +1,151 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XMETRICS_IMPL_HPP
+#define XMETRICS_IMPL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "xeus/xeus.hpp"
+#include "xeus/xmetrics.hpp"
+
+// The instrumentation macros expand to nothing unless
+// XEUS_ENABLE_METRICS is defined when building xeus.
+#ifdef XEUS_ENABLE_METRICS
+    #define XEUS_METRICS_TIME(histogram) \
+        ::xeus::xmetrics_timer XEUS_CONCATENATE(xeus_metrics_timer_, __LINE__)(::xeus::get_metrics_registry().histogram)
+    #define XEUS_METRICS_COUNT(name, size) \
+        ::xeus::get_metrics_registry().m_requests.increment(name, size)
+    #define XEUS_METRICS_SET(gauge, value) \
+        ::xeus::get_metrics_registry().gauge.store(static_cast<std::int64_t>(value), std::memory_order_relaxed)
+#else
+    #define XEUS_METRICS_TIME(histogram)
+    #define XEUS_METRICS_COUNT(name, size)
+    #define XEUS_METRICS_SET(gauge, value)
+#endif
+
+namespace xeus
+{
+
+    /**
+     * @class xhistogram
+     * @brief Lock-free log-linear histogram of durations in nanoseconds.
+     *
+     * Each power of two is split in 8 buckets, values below 8 have
+     * their own bucket.
+     */
+    class xhistogram
+    {
+    public:
+
+        xhistogram();
+
+        void record(std::uint64_t value) noexcept;
+        xhistogram_snapshot snapshot() const;
+
+        static constexpr std::size_t sub_bucket_count = 8;
+        static constexpr std::size_t bucket_count = 62 * sub_bucket_count;
+
+        static std::size_t bucket_index(std::uint64_t value) noexcept;
+        static std::uint64_t bucket_upper_bound(std::size_t index) noexcept;
+
+    private:
+
+        std::atomic<std::uint64_t> m_buckets[bucket_count];
+        std::atomic<std::uint64_t> m_count;
+        std::atomic<std::uint64_t> m_sum;
+    };
+
+    /**
+     * @class xcounter_table
+     * @brief Lock-free counters indexed by name.
+     *
+     * The table has a fixed number of slots, names arriving once it is
+     * full are counted under "other".
+     */
+    class xcounter_table
+    {
+    public:
+
+        xcounter_table();
+
+        void increment(const char* name, std::size_t size) noexcept;
+        void snapshot(std::map<std::string, std::uint64_t>& counters) const;
+
+    private:
+
+        static constexpr std::size_t slot_count = 128;
+        static constexpr std::size_t max_name_size = 64;
+
+        enum slot_state : int
+        {
+            empty = 0,
+            writing = 1,
+            ready = 2
+        };
+
+        struct slot
+        {
+            std::atomic<int> m_state;
+            char m_name[max_name_size];
+            std::size_t m_size;
+            std::atomic<std::uint64_t> m_count;
+        };
+
+        slot m_slots[slot_count];
+        std::atomic<std::uint64_t> m_other;
+    };
+
+    struct xmetrics_registry
+    {
+        xhistogram m_deserialize;
+        xhistogram m_handler;
+        xhistogram m_serialize;
+        xhistogram m_send;
+        xhistogram m_sign;
+        xhistogram m_verify;
+        xcounter_table m_requests;
+        std::atomic<std::int64_t> m_publish_queue_depth;
+
+        xmetrics_registry();
+    };
+
+    xmetrics_registry& get_metrics_registry();
+
+    class xmetrics_timer
+    {
+    public:
+
+        using clock_type = std::chrono::steady_clock;
+
+        explicit xmetrics_timer(xhistogram& histogram) noexcept
+            : m_histogram(histogram), m_start(clock_type::now())
+        {
+        }
+
+        ~xmetrics_timer()
+        {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - m_start);
+            m_histogram.record(static_cast<std::uint64_t>(elapsed.count()));
+        }
+
+        xmetrics_timer(const xmetrics_timer&) = delete;
+        xmetrics_timer& operator=(const xmetrics_timer&) = delete;
+
+    private:
+
+        xhistogram& m_histogram;
+        clock_type::time_point m_start;
+    };
+
+}
+
+#endif
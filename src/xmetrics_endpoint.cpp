@@ -0,0 +1,87 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include "xmetrics_endpoint.hpp"
+#include "xeus/xmetrics.hpp"
+#include "xmiddleware.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const std::string response_header =
+            "HTTP/1.0 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Connection: close\r\n\r\n";
+    }
+
+    xmetrics_endpoint::xmetrics_endpoint(zmq::context_t& context,
+                                         const std::string& server_id,
+                                         const std::string& ip,
+                                         const std::string& port)
+        : m_stream(context, zmq::socket_type::stream),
+          m_controller(context, zmq::socket_type::sub)
+    {
+        m_stream.setsockopt(ZMQ_LINGER, get_socket_linger());
+        // ZMQ_STREAM sockets only support TCP
+        m_stream.bind(get_end_point("tcp", ip, port));
+        m_controller.connect(get_controller_end_point(server_id));
+        m_controller.setsockopt(ZMQ_SUBSCRIBE, "stop", 4);
+    }
+
+    void xmetrics_endpoint::run()
+    {
+        zmq::pollitem_t items[] = {
+            { m_stream, 0, ZMQ_POLLIN, 0 },
+            { m_controller, 0, ZMQ_POLLIN, 0 }
+        };
+
+        while (true)
+        {
+            zmq::poll(&items[0], 2, -1);
+
+            if (items[0].revents & ZMQ_POLLIN)
+            {
+                zmq::message_t identity;
+                zmq::message_t data;
+                m_stream.recv(&identity);
+                m_stream.recv(&data);
+                // An empty frame notifies a connection or a disconnection.
+                // The request is not parsed: whatever the path, the
+                // metrics are sent back.
+                if (data.size() != 0)
+                {
+                    reply(identity);
+                }
+            }
+
+            // stop message
+            if (items[1].revents & ZMQ_POLLIN)
+            {
+                break;
+            }
+        }
+    }
+
+    void xmetrics_endpoint::reply(zmq::message_t& identity)
+    {
+        std::string response = response_header + format_prometheus(get_metrics());
+
+        zmq::message_t id_frame;
+        id_frame.copy(&identity);
+        m_stream.send(id_frame, ZMQ_SNDMORE);
+        zmq::message_t body(response.c_str(), response.size());
+        m_stream.send(body);
+
+        // Sending an empty frame closes the connection
+        m_stream.send(identity, ZMQ_SNDMORE);
+        zmq::message_t close_frame;
+        m_stream.send(close_frame);
+    }
+
+}
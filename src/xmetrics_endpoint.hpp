@@ -0,0 +1,50 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XMETRICS_ENDPOINT_HPP
+#define XMETRICS_ENDPOINT_HPP
+
+#include <string>
+
+#include "zmq.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xmetrics_endpoint
+     * @brief Minimal HTTP endpoint serving the metrics to Prometheus.
+     *
+     * Every request received on the TCP port is answered with the
+     * metrics in the text exposition format, and the connection is
+     * closed. The endpoint runs on its own thread until the server
+     * is stopped.
+     */
+    class xmetrics_endpoint
+    {
+
+    public:
+
+        xmetrics_endpoint(zmq::context_t& context,
+                          const std::string& server_id,
+                          const std::string& ip,
+                          const std::string& port);
+
+        void run();
+
+    private:
+
+        void reply(zmq::message_t& identity);
+
+        zmq::socket_t m_stream;
+        zmq::socket_t m_controller;
+    };
+
+}
+
+#endif
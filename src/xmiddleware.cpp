@@ -6,19 +6,50 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
 #include "xmiddleware.hpp"
 
 namespace xeus
 {
+    namespace
+    {
+        void set_option(zmq::socket_t& socket, int option, int value)
+        {
+            if (value >= 0)
+            {
+                socket.setsockopt(option, value);
+            }
+        }
+    }
+
+    std::string make_server_id()
+    {
+        static std::atomic<unsigned long> counter(0);
+        return std::to_string(counter++);
+    }
 
-    std::string get_controller_end_point()
+    std::string get_controller_end_point(const std::string& server_id)
     {
-        return "inproc://controller";
+        return "inproc://controller-" + server_id;
     }
 
-    std::string get_publisher_end_point()
+    std::string get_publisher_end_point(const std::string& server_id)
     {
-        return "inproc://publisher";
+        return "inproc://publisher-" + server_id;
+    }
+
+    std::string get_wakeup_end_point(const std::string& server_id)
+    {
+        return "inproc://wakeup-" + server_id;
+    }
+
+    std::string get_publish_queue_end_point(const std::string& server_id)
+    {
+        return "inproc://publish_queue-" + server_id;
     }
 
     std::string get_end_point(const std::string& transport,
@@ -29,8 +60,56 @@ namespace xeus
         return transport + "://" + ip + sep + port;
     }
 
+    std::string get_bound_port(const zmq::socket_t& socket)
+    {
+        char buffer[256];
+        std::size_t size = sizeof(buffer);
+        socket.getsockopt(ZMQ_LAST_ENDPOINT, buffer, &size);
+        // The size includes the null terminator
+        std::string end_point(buffer, size > 0 ? size - 1 : 0);
+        if (end_point.compare(0, 6, "tcp://") != 0)
+        {
+            return "";
+        }
+        return end_point.substr(end_point.rfind(':') + 1);
+    }
+
     int get_socket_linger()
     {
         return 1000;
     }
+
+    void set_socket_options(zmq::socket_t& socket, const xsocket_options& options)
+    {
+        socket.setsockopt(ZMQ_LINGER, options.m_linger >= 0 ? options.m_linger : get_socket_linger());
+        set_option(socket, ZMQ_SNDHWM, options.m_sndhwm);
+        set_option(socket, ZMQ_RCVHWM, options.m_rcvhwm);
+        set_option(socket, ZMQ_SNDBUF, options.m_sndbuf);
+        set_option(socket, ZMQ_RCVBUF, options.m_rcvbuf);
+        set_option(socket, ZMQ_TCP_KEEPALIVE, options.m_tcp_keepalive);
+        set_option(socket, ZMQ_TCP_KEEPALIVE_IDLE, options.m_tcp_keepalive_idle);
+        set_option(socket, ZMQ_TCP_KEEPALIVE_CNT, options.m_tcp_keepalive_cnt);
+        set_option(socket, ZMQ_TCP_KEEPALIVE_INTVL, options.m_tcp_keepalive_intvl);
+        set_option(socket, ZMQ_IMMEDIATE, options.m_immediate);
+        set_option(socket, ZMQ_USE_FD, options.m_use_fd);
+    }
+
+    void set_context_options(zmq::context_t& context, const xconfiguration& config)
+    {
+        if (config.m_io_threads > 0)
+        {
+            context.setctxopt(ZMQ_IO_THREADS, config.m_io_threads);
+        }
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+        for (int cpu : config.m_io_thread_affinity)
+        {
+            context.setctxopt(ZMQ_THREAD_AFFINITY_CPU_ADD, cpu);
+        }
+#else
+        if (!config.m_io_thread_affinity.empty())
+        {
+            std::cerr << "ERROR: io_thread_affinity requires ZeroMQ 4.3" << std::endl;
+        }
+#endif
+    }
 }
@@ -11,18 +11,37 @@
 
 #include <string>
 
+#include "zmq.hpp"
+
+#include "xeus/xkernel_configuration.hpp"
+
 namespace xeus
 {
 
-    std::string get_controller_end_point();
-    std::string get_publisher_end_point();
+    // Servers sharing a context use distinct inproc end points,
+    // suffixed by the id of the server.
+    std::string make_server_id();
+
+    std::string get_controller_end_point(const std::string& server_id);
+    std::string get_publisher_end_point(const std::string& server_id);
+    std::string get_wakeup_end_point(const std::string& server_id);
+    std::string get_publish_queue_end_point(const std::string& server_id);
 
     std::string get_end_point(const std::string& transport,
                               const std::string& ip,
                               const std::string& port);
 
+    // Port of the last tcp end point socket has been bound to, empty
+    // for other transports. When a channel is bound to port 0, this
+    // is the port picked by the system.
+    std::string get_bound_port(const zmq::socket_t& socket);
+
     int get_socket_linger();
 
+    // Sets the options of a socket bound on a Jupyter channel
+    void set_socket_options(zmq::socket_t& socket, const xsocket_options& options);
+    void set_context_options(zmq::context_t& context, const xconfiguration& config);
+
 }
 
 #endif
@@ -14,7 +14,7 @@
 
 namespace xeus
 {
-    class xmock_interpreter : public xinterpreter
+    class XEUS_API xmock_interpreter : public xinterpreter
     {
     public:
 
@@ -0,0 +1,170 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstring>
+#include <utility>
+
+#include "xeus/xjson.hpp"
+#include "xmetrics.hpp"
+#include "xmiddleware.hpp"
+#include "xpublish_queue.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const std::string stream_suffix = ".stream";
+
+        bool is_stream(const xpub_message& message)
+        {
+            const std::string& topic = message.topic();
+            return topic.size() >= stream_suffix.size() &&
+                topic.compare(topic.size() - stream_suffix.size(), stream_suffix.size(), stream_suffix) == 0;
+        }
+
+        bool same_parent(const xpub_message& lhs, const xpub_message& rhs)
+        {
+            const xjson_frame& lhs_parent = lhs.parent_header_frame();
+            const xjson_frame& rhs_parent = rhs.parent_header_frame();
+            if (lhs_parent.has_frame() && rhs_parent.has_frame())
+            {
+                const zmq::message_t& lhs_frame = lhs_parent.frame();
+                const zmq::message_t& rhs_frame = rhs_parent.frame();
+                return lhs_frame.size() == rhs_frame.size() &&
+                    std::memcmp(lhs_frame.data(), rhs_frame.data(), lhs_frame.size()) == 0;
+            }
+            return lhs_parent.get() == rhs_parent.get();
+        }
+    }
+
+    publish_policy make_publish_policy(const std::string& name)
+    {
+        if (name == "drop_oldest_stream")
+        {
+            return publish_policy::drop_oldest_stream;
+        }
+        else if (name == "coalesce")
+        {
+            return publish_policy::coalesce;
+        }
+        return publish_policy::block;
+    }
+
+    xpublish_queue::xpublish_queue(zmq::context_t& context,
+                                   const std::string& server_id,
+                                   std::size_t capacity,
+                                   publish_policy policy)
+        : m_notifier_push(context, zmq::socket_type::push),
+          m_notifier_pull(context, zmq::socket_type::pull),
+          m_capacity(capacity == 0 ? 1 : capacity),
+          m_policy(policy),
+          m_closed(false)
+    {
+        m_notifier_pull.setsockopt(ZMQ_LINGER, get_socket_linger());
+        m_notifier_pull.bind(get_publish_queue_end_point(server_id));
+        m_notifier_push.setsockopt(ZMQ_LINGER, get_socket_linger());
+        m_notifier_push.connect(get_publish_queue_end_point(server_id));
+    }
+
+    void xpublish_queue::push(xpub_message message)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_closed && m_queue.size() >= m_capacity)
+        {
+            if (m_policy == publish_policy::coalesce && coalesce(message))
+            {
+                return;
+            }
+            if (m_policy != publish_policy::drop_oldest_stream || !drop_oldest_stream())
+            {
+                m_not_full.wait(lock, [this]() { return m_closed || m_queue.size() < m_capacity; });
+            }
+        }
+
+        if (m_closed)
+        {
+            return;
+        }
+
+        m_queue.push_back(std::move(message));
+        XEUS_METRICS_SET(m_publish_queue_depth, m_queue.size());
+        // The consumer takes every queued message when it is notified,
+        // a single notification is needed until the queue is drained.
+        if (m_queue.size() == 1)
+        {
+            zmq::message_t notification;
+            m_notifier_push.send(notification);
+        }
+    }
+
+    zmq::socket_t& xpublish_queue::notifier() noexcept
+    {
+        return m_notifier_pull;
+    }
+
+    void xpublish_queue::pop_all(message_list& messages)
+    {
+        zmq::message_t notification;
+        while (m_notifier_pull.recv(&notification, ZMQ_NOBLOCK))
+        {
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            messages.swap(m_queue);
+            XEUS_METRICS_SET(m_publish_queue_depth, m_queue.size());
+        }
+        m_not_full.notify_all();
+    }
+
+    void xpublish_queue::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            m_queue.clear();
+        }
+        m_not_full.notify_all();
+    }
+
+    bool xpublish_queue::drop_oldest_stream()
+    {
+        for (auto iter = m_queue.begin(); iter != m_queue.end(); ++iter)
+        {
+            if (is_stream(*iter))
+            {
+                m_queue.erase(iter);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool xpublish_queue::coalesce(xpub_message& message)
+    {
+        // Merging with an older message would reorder the output
+        if (m_queue.empty() || !is_stream(message) || !is_stream(m_queue.back()))
+        {
+            return false;
+        }
+
+        xpub_message& last = m_queue.back();
+        const xjson& content = message.content();
+        if (content.value("name", "") != last.content().value("name", "") ||
+            !same_parent(message, last))
+        {
+            return false;
+        }
+
+        // Appended in place, the merged text is not copied
+        std::string& text = last.mutable_content()["text"].get_ref<std::string&>();
+        text.append(content["text"].get_ref<const std::string&>());
+        return true;
+    }
+
+}
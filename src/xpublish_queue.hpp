@@ -0,0 +1,94 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XPUBLISH_QUEUE_HPP
+#define XPUBLISH_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "zmq.hpp"
+
+#include "xeus/xmessage.hpp"
+
+namespace xeus
+{
+
+    // What a producer does when the publish queue is full.
+    // block: waits for the publisher thread to make room.
+    // drop_oldest_stream: drops the oldest queued stream message, or
+    // blocks if there is none.
+    // coalesce: appends a stream message to the last queued one when they
+    // have the same parent and stream name, blocks otherwise.
+    enum class publish_policy
+    {
+        block,
+        drop_oldest_stream,
+        coalesce
+    };
+
+    // Unknown names select the block policy
+    publish_policy make_publish_policy(const std::string& name);
+
+    /**
+     * @class xpublish_queue
+     * @brief Bounded queue of messages waiting to be serialized and sent on iopub.
+     *
+     * Any thread may push messages, a single consumer pops them. The
+     * consumer is notified through an inproc socket when the queue stops
+     * being empty, so it can wait for messages with zmq::poll.
+     */
+    class xpublish_queue
+    {
+    public:
+
+        using message_list = std::deque<xpub_message>;
+
+        xpublish_queue(zmq::context_t& context,
+                       const std::string& server_id,
+                       std::size_t capacity,
+                       publish_policy policy);
+
+        xpublish_queue(const xpublish_queue&) = delete;
+        xpublish_queue& operator=(const xpublish_queue&) = delete;
+
+        xpublish_queue(xpublish_queue&&) = delete;
+        xpublish_queue& operator=(xpublish_queue&&) = delete;
+
+        void push(xpub_message message);
+
+        // Consumer side: the socket to poll, and the queued messages
+        // which are moved to messages.
+        zmq::socket_t& notifier() noexcept;
+        void pop_all(message_list& messages);
+
+        // Messages pushed after the queue is closed are dropped
+        void close();
+
+    private:
+
+        bool drop_oldest_stream();
+        bool coalesce(xpub_message& message);
+
+        zmq::socket_t m_notifier_push;
+        zmq::socket_t m_notifier_pull;
+
+        std::mutex m_mutex;
+        std::condition_variable m_not_full;
+        message_list m_queue;
+        std::size_t m_capacity;
+        publish_policy m_policy;
+        bool m_closed;
+    };
+
+}
+
+#endif
@@ -6,53 +6,239 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <string>
+
 #include "xpublisher.hpp"
 #include "zmq_addon.hpp"
+#include "xmetrics.hpp"
 #include "xmiddleware.hpp"
 
 namespace xeus
 {
+    constexpr std::size_t xpublisher::poll_size;
+
+    namespace
+    {
+        // Counts larger than the tail are clamped, anything
+        // else than decimal digits is rejected.
+        bool parse_count(const zmq::message_t& frame, std::size_t& count)
+        {
+            const char* it = frame.data<const char>();
+            const char* end = it + frame.size();
+            if (it == end)
+            {
+                return false;
+            }
+
+            const std::size_t max = std::numeric_limits<std::size_t>::max();
+            count = 0;
+            for (; it != end; ++it)
+            {
+                if (*it < '0' || *it > '9')
+                {
+                    return false;
+                }
+                std::size_t digit = static_cast<std::size_t>(*it - '0');
+                count = count > (max - digit) / 10 ? max : count * 10 + digit;
+            }
+            return true;
+        }
+    }
 
     xpublisher::xpublisher(zmq::context_t& context,
-                           const std::string& transport,
-                           const std::string& ip,
-                           const std::string& port)
+                           const std::string& server_id,
+                           const xconfiguration& config,
+                           std::shared_ptr<xshm_transport> shm)
         : m_publisher(context, zmq::socket_type::pub),
           m_listener(context, zmq::socket_type::sub),
-          m_controller(context, zmq::socket_type::sub)
+          m_controller(context, zmq::socket_type::sub),
+          m_replay_socket(context, zmq::socket_type::router),
+          p_auth(make_xauthentication(config.m_signature_scheme, config.m_key)),
+          m_batcher(*p_auth, config.m_stream_batch_window, config.m_stream_batch_size),
+          m_compressor(config.m_iopub_compression, config.m_iopub_compression_level, config.m_iopub_compression_threshold),
+          m_queue(context, server_id, config.m_publish_queue_size, make_publish_policy(config.m_publish_policy)),
+          m_replay(config.m_iopub_replay_port.empty() ? 0 : config.m_iopub_replay_size, config.m_iopub_replay_bytes),
+          p_shm(std::move(shm))
     {
-        m_publisher.setsockopt(ZMQ_LINGER, get_socket_linger());
-        m_publisher.bind(get_end_point(transport, ip, port));
-        m_listener.connect(get_publisher_end_point());
+        set_socket_options(m_publisher, config.m_iopub_options);
+        m_publisher.bind(get_end_point(config.m_transport, config.m_ip, config.m_iopub_port));
+        m_listener.connect(get_publisher_end_point(server_id));
         m_listener.setsockopt(ZMQ_SUBSCRIBE, "", 0);
-        m_controller.connect(get_controller_end_point());
-        m_controller.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+        m_controller.connect(get_controller_end_point(server_id));
+        // Restart messages are only for the control channel
+        m_controller.setsockopt(ZMQ_SUBSCRIBE, "stop", 4);
+
+        // The socket is polled even when it is not bound, it is then
+        // never readable.
+        m_replay_socket.setsockopt(ZMQ_LINGER, get_socket_linger());
+        if (m_replay.enabled())
+        {
+            // A router drops what exceeds the high water mark, the
+            // size of a replay is already bounded by the buffer.
+            m_replay_socket.setsockopt(ZMQ_SNDHWM, 0);
+            m_replay_socket.bind(get_end_point(config.m_transport, config.m_ip, config.m_iopub_replay_port));
+        }
+    }
+
+    void xpublisher::publish(xpub_message message)
+    {
+        m_queue.push(std::move(message));
+    }
+
+    std::string xpublisher::port() const
+    {
+        return get_bound_port(m_publisher);
+    }
+
+    std::string xpublisher::replay_port() const
+    {
+        return get_bound_port(m_replay_socket);
+    }
+
+    void xpublisher::init_poll_items(zmq::pollitem_t* items)
+    {
+        items[0] = { m_listener, 0, ZMQ_POLLIN, 0 };
+        items[1] = { m_controller, 0, ZMQ_POLLIN, 0 };
+        items[2] = { m_queue.notifier(), 0, ZMQ_POLLIN, 0 };
+        items[3] = { m_replay_socket, 0, ZMQ_POLLIN, 0 };
+    }
+
+    long xpublisher::poll_timeout() const
+    {
+        return m_batcher.timeout();
+    }
+
+    bool xpublisher::process(const zmq::pollitem_t* items)
+    {
+        if (items[0].revents & ZMQ_POLLIN)
+        {
+            zmq::multipart_t wire_msg;
+            wire_msg.recv(m_listener);
+            forward(wire_msg);
+        }
+
+        if (items[2].revents & ZMQ_POLLIN)
+        {
+            forward_queued();
+        }
+
+        if (m_batcher.expired())
+        {
+            m_batcher.flush(m_publisher);
+        }
+
+        if (items[3].revents & ZMQ_POLLIN)
+        {
+            replay();
+        }
+
+        if (items[1].revents & ZMQ_POLLIN)
+        {
+            // stop message, messages queued
+            // before it are still sent.
+            forward_queued();
+            m_batcher.flush(m_publisher);
+            m_queue.close();
+            return false;
+        }
+        return true;
     }
 
     void xpublisher::run()
     {
-        zmq::pollitem_t items[] = {
-            { m_listener, 0, ZMQ_POLLIN, 0 },
-            { m_controller, 0, ZMQ_POLLIN, 0 }
-        };
+        zmq::pollitem_t items[poll_size];
+        init_poll_items(&items[0]);
+        do
+        {
+            zmq::poll(&items[0], poll_size, poll_timeout());
+        }
+        while (process(&items[0]));
+    }
 
-        while (true)
+    void xpublisher::forward(zmq::multipart_t& wire_msg)
+    {
+        XEUS_METRICS_TIME(m_send);
+        // Recorded before the buffers are moved to shm, replayed
+        // messages may be received by another host.
+        m_replay.record(wire_msg);
+        if (p_shm != nullptr)
         {
-            zmq::poll(&items[0], 2, -1);
+            p_shm->export_buffers(wire_msg);
+        }
 
-            if (items[0].revents & ZMQ_POLLIN)
+        if (m_batcher.enabled() && m_batcher.is_stream(wire_msg))
+        {
+            if (!m_batcher.append(wire_msg))
             {
-                zmq::multipart_t wire_msg;
-                wire_msg.recv(m_listener);
-                wire_msg.send(m_publisher);
+                m_batcher.flush(m_publisher);
+                m_batcher.append(wire_msg);
             }
+        }
+        else
+        {
+            // Any other message (including status changes) flushes the
+            // pending batch first so the ordering on iopub is preserved.
+            m_batcher.flush(m_publisher);
+            wire_msg.send(m_publisher);
+        }
+    }
 
-            if (items[1].revents & ZMQ_POLLIN)
+    void xpublisher::forward_queued()
+    {
+        m_queue.pop_all(m_queued);
+        for (const auto& message : m_queued)
+        {
+            zmq::multipart_t wire_msg;
+            // Messages are serialized on the publisher thread, away from
+            // the handler of the request. A message that cannot be
+            // serialized (e.g. with a string that is not valid UTF-8)
+            // is dropped instead of terminating the thread.
+            try
+            {
+                if (m_compressor.accepts(message))
+                {
+                    m_compressor.serialize(message, wire_msg, *p_auth);
+                }
+                else
+                {
+                    message.serialize(wire_msg, *p_auth);
+                }
+            }
+            catch (std::exception& e)
             {
-                // stop or restart message
-                break;
+                std::cerr << "ERROR: dropping iopub message: " << e.what() << std::endl;
+                continue;
             }
+            forward(wire_msg);
+        }
+        m_queued.clear();
+    }
+
+    void xpublisher::replay()
+    {
+        zmq::multipart_t request;
+        request.recv(m_replay_socket);
+        if (request.size() < 2)
+        {
+            return;
+        }
+
+        zmq::message_t identity = request.pop();
+        zmq::message_t count_frame = request.pop();
+        std::size_t count = m_replay.size();
+        if (count_frame.size() != 0 && !parse_count(count_frame, count))
+        {
+            std::cerr << "ERROR: invalid iopub replay count" << std::endl;
+            zmq::multipart_t reply;
+            reply.add(std::move(identity));
+            reply.add(zmq::message_t());
+            reply.send(m_replay_socket);
+            return;
         }
+        m_replay.replay(m_replay_socket, identity, count);
     }
 
 }
@@ -9,27 +9,84 @@
 #ifndef XPUBLISHER_HPP
 #define XPUBLISHER_HPP
 
+#include <cstddef>
+#include <memory>
+#include <string>
+
 #include "zmq.hpp"
 
+#include "xeus/xauthentication.hpp"
+#include "xeus/xkernel_configuration.hpp"
+#include "xeus/xmessage.hpp"
+#include "xcompression.hpp"
+#include "xpublish_queue.hpp"
+#include "xreplay_buffer.hpp"
+#include "xshm_transport.hpp"
+#include "xstream_batcher.hpp"
+
 namespace xeus
 {
 
+    /**
+     * When the configuration has an iopub replay port, the tail of the
+     * published messages is also served on a router socket bound to it.
+     * A client sends a single frame, holding the number of messages it
+     * wants as a decimal string, or empty for the whole tail. It receives
+     * the last status message if it is older than the requested messages,
+     * then the messages, each of them with the frames published on iopub,
+     * and finally an empty frame. A request whose count is not a decimal
+     * number only receives the empty frame.
+     */
     class xpublisher
     {
     public:
 
+        // Binary buffers go through shm when it is not null
         xpublisher(zmq::context_t& context,
-                   const std::string& transport,
-                   const std::string& ip,
-                   const std::string& port);
+                   const std::string& server_id,
+                   const xconfiguration& config,
+                   std::shared_ptr<xshm_transport> shm = nullptr);
+
+        // Queues message, which is serialized and signed by the
+        // publisher thread. Safe to call from any thread.
+        void publish(xpub_message message);
+
+        // Ports the iopub channel and the replay socket are bound
+        // to, see get_bound_port. The latter is empty when replay
+        // is disabled.
+        std::string port() const;
+        std::string replay_port() const;
 
+        // A publisher is either run on its own thread, or served
+        // by an xserver_pump along with other publishers.
         void run();
 
+        static constexpr std::size_t poll_size = 4;
+        void init_poll_items(zmq::pollitem_t* items);
+        long poll_timeout() const;
+        // Returns false once the publisher has been stopped
+        bool process(const zmq::pollitem_t* items);
+
     private:
 
+        void forward(zmq::multipart_t& wire_msg);
+        void forward_queued();
+        void replay();
+
         zmq::socket_t m_publisher;
         zmq::socket_t m_listener;
         zmq::socket_t m_controller;
+        zmq::socket_t m_replay_socket;
+
+        // Queued and merged stream messages are signed in the
+        // publisher thread, hence the dedicated authentication object.
+        std::unique_ptr<xauthentication> p_auth;
+        xstream_batcher m_batcher;
+        xcompressor m_compressor;
+        xpublish_queue m_queue;
+        xpublish_queue::message_list m_queued;
+        xreplay_buffer m_replay;
+        std::shared_ptr<xshm_transport> p_shm;
     };
 
 }
@@ -0,0 +1,134 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "xreplay_buffer.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const std::string status_suffix = ".status";
+
+        // The frames are shared, not copied
+        zmq::message_t share_frame(const zmq::message_t& frame)
+        {
+            zmq::message_t res;
+            res.copy(&frame);
+            return res;
+        }
+
+        bool is_status(const zmq::multipart_t& wire_msg)
+        {
+            // The topic is "kernel_core.<kernel_id>.<msg_type>"
+            const zmq::message_t* topic = wire_msg.peek(0);
+            std::size_t size = topic->size();
+            std::size_t suffix_size = status_suffix.size();
+            return size >= suffix_size &&
+                std::memcmp(topic->data<const char>() + size - suffix_size,
+                            status_suffix.c_str(), suffix_size) == 0;
+        }
+    }
+
+    xreplay_buffer::xreplay_buffer(std::size_t max_size, std::size_t max_bytes)
+        : m_max_size(max_size),
+          m_max_bytes(max_bytes),
+          m_bytes(0),
+          m_sequence(0),
+          m_entries(),
+          m_status{0, 0, zmq::multipart_t()}
+    {
+    }
+
+    bool xreplay_buffer::enabled() const noexcept
+    {
+        return m_max_size != 0;
+    }
+
+    std::size_t xreplay_buffer::size() const noexcept
+    {
+        return m_entries.size();
+    }
+
+    void xreplay_buffer::record(const zmq::multipart_t& wire_msg)
+    {
+        if (!enabled() || wire_msg.empty())
+        {
+            return;
+        }
+
+        entry e{m_sequence++, 0, zmq::multipart_t()};
+        for (std::size_t i = 0; i < wire_msg.size(); ++i)
+        {
+            const zmq::message_t* frame = wire_msg.peek(i);
+            e.m_bytes += frame->size();
+            e.m_frames.add(share_frame(*frame));
+        }
+
+        if (is_status(wire_msg))
+        {
+            m_status.m_sequence = e.m_sequence;
+            m_status.m_frames.clear();
+            for (std::size_t i = 0; i < e.m_frames.size(); ++i)
+            {
+                m_status.m_frames.add(share_frame(*e.m_frames.peek(i)));
+            }
+        }
+
+        // A message larger than the limit is still kept, alone
+        m_bytes += e.m_bytes;
+        m_entries.push_back(std::move(e));
+        while (m_entries.size() > 1 &&
+               (m_entries.size() > m_max_size || m_bytes > m_max_bytes))
+        {
+            m_bytes -= m_entries.front().m_bytes;
+            m_entries.pop_front();
+        }
+    }
+
+    void xreplay_buffer::replay(zmq::socket_t& socket,
+                                const zmq::message_t& identity,
+                                std::size_t count) const
+    {
+        std::size_t first = m_entries.size() > count ? m_entries.size() - count : 0;
+
+        // The last status went out of the tail
+        bool has_status = !m_status.m_frames.empty();
+        if (has_status && (first == m_entries.size() || m_status.m_sequence < m_entries[first].m_sequence))
+        {
+            send(socket, identity, m_status.m_frames);
+        }
+
+        for (std::size_t i = first; i < m_entries.size(); ++i)
+        {
+            send(socket, identity, m_entries[i].m_frames);
+        }
+
+        zmq::multipart_t end;
+        end.add(share_frame(identity));
+        end.add(zmq::message_t());
+        end.send(socket);
+    }
+
+    void xreplay_buffer::send(zmq::socket_t& socket,
+                              const zmq::message_t& identity,
+                              const zmq::multipart_t& frames) const
+    {
+        zmq::multipart_t wire_msg;
+        wire_msg.add(share_frame(identity));
+        for (std::size_t i = 0; i < frames.size(); ++i)
+        {
+            wire_msg.add(share_frame(*frames.peek(i)));
+        }
+        wire_msg.send(socket);
+    }
+
+}
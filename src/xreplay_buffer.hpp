@@ -0,0 +1,72 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XREPLAY_BUFFER_HPP
+#define XREPLAY_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xreplay_buffer
+     * @brief Tail of the messages published on iopub.
+     *
+     * Serialized messages are recorded as they are: the frames are shared
+     * with the published ones, nothing is serialized again on replay. At
+     * most max_size messages, and max_bytes bytes of frames, are kept. The
+     * last status message is kept even once it has left the tail, so that
+     * a replay always tells the state of the kernel.
+     */
+    class xreplay_buffer
+    {
+    public:
+
+        xreplay_buffer(std::size_t max_size, std::size_t max_bytes);
+
+        bool enabled() const noexcept;
+        std::size_t size() const noexcept;
+
+        void record(const zmq::multipart_t& wire_msg);
+
+        // Sends the last count messages on a router socket, each of
+        // them prefixed with identity, followed by an empty frame.
+        void replay(zmq::socket_t& socket,
+                    const zmq::message_t& identity,
+                    std::size_t count) const;
+
+    private:
+
+        struct entry
+        {
+            std::uint64_t m_sequence;
+            std::size_t m_bytes;
+            zmq::multipart_t m_frames;
+        };
+
+        void send(zmq::socket_t& socket,
+                  const zmq::message_t& identity,
+                  const zmq::multipart_t& frames) const;
+
+        std::size_t m_max_size;
+        std::size_t m_max_bytes;
+        std::size_t m_bytes;
+        std::uint64_t m_sequence;
+        std::deque<entry> m_entries;
+        entry m_status;
+    };
+
+}
+
+#endif
@@ -0,0 +1,39 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include "xrequest_context.hpp"
+
+namespace xeus
+{
+
+    // Used outside of any request, the empty parent header
+    // is serialized once here rather than for every message.
+    xrequest_context::xrequest_context()
+        : m_id(), m_header(zmq::message_t("{}", 2))
+    {
+    }
+
+    // Taking a copy of the frame marks it as shared, further copies
+    // from any thread only increment its reference count.
+    xrequest_context::xrequest_context(const xmessage& request)
+        : m_id(request.identities()),
+          m_header(request.header_frame().serialize())
+    {
+    }
+
+    auto xrequest_context::id() const noexcept -> const guid_list&
+    {
+        return m_id;
+    }
+
+    const xjson_frame& xrequest_context::header() const noexcept
+    {
+        return m_header;
+    }
+
+}
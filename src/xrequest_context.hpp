@@ -0,0 +1,50 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XREQUEST_CONTEXT_HPP
+#define XREQUEST_CONTEXT_HPP
+
+#include <memory>
+
+#include "xeus/xmessage.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xrequest_context
+     * @brief Identities and header of the request being handled.
+     *
+     * Replies and messages published while handling a request use them
+     * as their destination and parent header. A context is immutable and
+     * shared between the threads taking part in the request: the header
+     * is kept as the frame received on the wire, which is never parsed
+     * and is shared by every outgoing message instead of being copied.
+     */
+    class xrequest_context
+    {
+    public:
+
+        using guid_list = xmessage::guid_list;
+        using pointer = std::shared_ptr<const xrequest_context>;
+
+        xrequest_context();
+        explicit xrequest_context(const xmessage& request);
+
+        const guid_list& id() const noexcept;
+        const xjson_frame& header() const noexcept;
+
+    private:
+
+        guid_list m_id;
+        xjson_frame m_header;
+    };
+
+}
+
+#endif
@@ -8,7 +8,12 @@
 
 #include "xeus/xserver.hpp"
 #include "xeus/make_unique.hpp"
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
 #include "xserver_impl.hpp"
+#include "xshm_transport.hpp"
 
 namespace xeus
 {
@@ -32,14 +37,24 @@ namespace xeus
         publish_impl(message);
     }
 
+    void xserver::publish(xpub_message message)
+    {
+        publish_message_impl(std::move(message));
+    }
+
+    bool xserver::poll_shell(zmq::multipart_t& message)
+    {
+        return poll_shell_impl(message);
+    }
+
     void xserver::start(zmq::multipart_t& message)
     {
         start_impl(message);
     }
 
-    void xserver::abort_queue(const listener& l, long polling_interval)
+    void xserver::abort_queue(const listener& l, long grace_period)
     {
-        abort_queue_impl(l, polling_interval);
+        abort_queue_impl(l, grace_period);
     }
 
     void xserver::stop()
@@ -47,6 +62,42 @@ namespace xeus
         stop_impl();
     }
 
+    void xserver::restart()
+    {
+        restart_impl();
+    }
+
+    void xserver::hold_shell(const std::vector<std::string>& allowed_types)
+    {
+        hold_shell_impl(allowed_types);
+    }
+
+    void xserver::release_shell()
+    {
+        release_shell_impl();
+    }
+
+    void xserver::update_ports(xconfiguration& config) const
+    {
+        update_ports_impl(config);
+    }
+
+    void xserver::restart_impl()
+    {
+    }
+
+    void xserver::hold_shell_impl(const std::vector<std::string>& /*allowed_types*/)
+    {
+    }
+
+    void xserver::release_shell_impl()
+    {
+    }
+
+    void xserver::update_ports_impl(xconfiguration& /*config*/) const
+    {
+    }
+
     void xserver::register_shell_listener(const listener& l)
     {
         m_shell_listener = l;
@@ -62,6 +113,11 @@ namespace xeus
         m_stdin_listener = l;
     }
 
+    void xserver::register_idle_listener(const idle_listener& l)
+    {
+        m_idle_listener = l;
+    }
+
     void xserver::notify_shell_listener(zmq::multipart_t& message)
     {
         m_shell_listener(message);
@@ -77,9 +133,28 @@ namespace xeus
         m_stdin_listener(message);
     }
 
+    void xserver::notify_idle_listener()
+    {
+        if (m_idle_listener)
+        {
+            m_idle_listener();
+        }
+    }
+
     std::unique_ptr<xserver> make_xserver(zmq::context_t& context,
                                           const xconfiguration& config)
     {
         return ::xeus::make_unique<xserver_impl>(context, config);
     }
+
+    std::unique_ptr<xserver> make_xserver_shm(zmq::context_t& context,
+                                              const xconfiguration& config)
+    {
+        if (config.m_transport != "ipc")
+        {
+            throw std::runtime_error("the shared memory server requires the ipc transport");
+        }
+        auto shm = std::make_shared<xshm_transport>(config);
+        return ::xeus::make_unique<xserver_impl>(context, config, std::move(shm));
+    }
 }
@@ -9,126 +9,397 @@
 #include "xserver_impl.hpp"
 #include <thread>
 #include <chrono>
+#include <iostream>
 #include "zmq_addon.hpp"
+#include "xeus/make_unique.hpp"
 #include "xmiddleware.hpp"
 
 namespace xeus
 {
 
     void init_socket(zmq::socket_t& socket,
-        const std::string& end_point)
+        const std::string& end_point,
+        const xsocket_options& options = xsocket_options())
     {
-        socket.setsockopt(ZMQ_LINGER, get_socket_linger());
+        set_socket_options(socket, options);
         socket.bind(end_point);
     }
 
+    // Empty ports are those of channels not bound with tcp
+    void update_port(std::string& port, const std::string& bound_port)
+    {
+        if (!bound_port.empty())
+        {
+            port = bound_port;
+        }
+    }
+
+    // Default receive high water mark of ZeroMQ sockets
+    constexpr std::size_t default_shell_queue_size = 1000;
+
     xserver_impl::xserver_impl(zmq::context_t& context,
-                               const xconfiguration& c)
-        : m_shell(context, zmq::socket_type::router),
-          m_controller(context, zmq::socket_type::router),
+                               const xconfiguration& c,
+                               shm_transport_ptr shm,
+                               xserver_pump* pump)
+        : m_id(make_server_id()),
+          m_shell(context, zmq::socket_type::router),
           m_stdin(context, zmq::socket_type::router),
           m_publisher_pub(context, zmq::socket_type::pub),
           m_controller_pub(context, zmq::socket_type::pub),
-          m_publisher(context, c.m_transport, c.m_ip, c.m_iopub_port),
-          m_heartbeat(context, c.m_transport, c.m_ip, c.m_hb_port),
-          m_request_stop(false)
+          m_wakeup_push(context, zmq::socket_type::push),
+          m_wakeup_pull(context, zmq::socket_type::pull),
+          m_control(context, m_id, c.m_transport, c.m_ip, c.m_control_port, c.m_control_options),
+          m_publisher(context, m_id, c, shm),
+          m_heartbeat(context, m_id, c.m_transport, c.m_ip, c.m_hb_port, c.m_hb_options),
+          m_shell_scheduler(c.m_shell_priority, c.m_shell_priority_burst),
+          m_shell_queue_size(c.m_shell_options.m_rcvhwm > 0 ? static_cast<std::size_t>(c.m_shell_options.m_rcvhwm)
+                                                            : default_shell_queue_size),
+          m_release_shell(false),
+          m_stdin_timeout(c.m_stdin_timeout),
+          m_input_pending(false),
+          m_request_stop(false),
+          m_request_restart(false),
+          m_started(false),
+          p_shm(std::move(shm)),
+          m_dedicated_heartbeat(c.m_dedicated_heartbeat),
+          p_metrics(c.m_metrics_port.empty() ? std::unique_ptr<xmetrics_endpoint>()
+                                             : ::xeus::make_unique<xmetrics_endpoint>(context, m_id, c.m_ip, c.m_metrics_port)),
+          p_own_pump(pump == nullptr ? ::xeus::make_unique<xserver_pump>(context) : std::unique_ptr<xserver_pump>()),
+          p_pump(pump == nullptr ? p_own_pump.get() : pump)
     {
-        init_socket(m_shell, get_end_point(c.m_transport, c.m_ip, c.m_shell_port));
-        init_socket(m_controller, get_end_point(c.m_transport, c.m_ip, c.m_control_port));
-        init_socket(m_stdin, get_end_point(c.m_transport, c.m_ip, c.m_stdin_port));
-        init_socket(m_publisher_pub, get_publisher_end_point());
-        init_socket(m_controller_pub, get_controller_end_point());
+        init_socket(m_shell, get_end_point(c.m_transport, c.m_ip, c.m_shell_port), c.m_shell_options);
+        init_socket(m_stdin, get_end_point(c.m_transport, c.m_ip, c.m_stdin_port), c.m_stdin_options);
+        init_socket(m_publisher_pub, get_publisher_end_point(m_id));
+        init_socket(m_controller_pub, get_controller_end_point(m_id));
+        init_socket(m_wakeup_pull, get_wakeup_end_point(m_id));
+        m_wakeup_push.setsockopt(ZMQ_LINGER, get_socket_linger());
+        m_wakeup_push.connect(get_wakeup_end_point(m_id));
     }
 
     void xserver_impl::send_shell_impl(zmq::multipart_t& message)
     {
-        message.send(m_shell);
+        if (std::this_thread::get_id() == m_shell_thread)
+        {
+            message.send(m_shell);
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+                m_pending_shell.push_back(std::move(message));
+            }
+            wakeup();
+        }
     }
 
     void xserver_impl::send_control_impl(zmq::multipart_t& message)
     {
-        message.send(m_controller);
+        // Only called from the control thread
+        m_control.send(message);
     }
 
     void xserver_impl::send_stdin_impl(zmq::multipart_t& message)
     {
         message.send(m_stdin);
-        zmq::multipart_t wire_msg;
-        wire_msg.recv(m_stdin);
-        xserver::notify_stdin_listener(wire_msg);
+
+        // The reply is received by poll_channels, the control channel
+        // is served by its own thread in the meantime.
+        using clock_type = std::chrono::steady_clock;
+        auto deadline = clock_type::now() + std::chrono::milliseconds(m_stdin_timeout);
+        m_input_pending = true;
+        while (m_input_pending && !m_request_stop)
+        {
+            long timeout = -1;
+            if (m_stdin_timeout >= 0)
+            {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock_type::now());
+                if (remaining.count() <= 0)
+                {
+                    std::cerr << "ERROR: timeout while waiting for input_reply" << std::endl;
+                    break;
+                }
+                timeout = static_cast<long>(remaining.count());
+            }
+            poll_channels(timeout);
+        }
+        m_input_pending = false;
     }
 
     void xserver_impl::publish_impl(zmq::multipart_t& message)
     {
+        std::lock_guard<std::mutex> lock(m_publish_mutex);
         message.send(m_publisher_pub);
     }
 
-    void xserver_impl::start_impl(zmq::multipart_t& message)
+    void xserver_impl::publish_message_impl(xpub_message message)
     {
-        std::thread iopub_thread(&xpublisher::run, &m_publisher);
-        iopub_thread.detach();
+        m_publisher.publish(std::move(message));
+    }
 
-        std::thread hb_thread(&xheartbeat::run, &m_heartbeat);
-        hb_thread.detach();
+    bool xserver_impl::poll_shell_impl(zmq::multipart_t& message)
+    {
+        receive_shell();
+        return m_shell_scheduler.pop(message);
+    }
 
-        m_request_stop = false;
+    void xserver_impl::start_impl(zmq::multipart_t& message)
+    {
+        if (!m_started)
+        {
+            if (m_dedicated_heartbeat)
+            {
+                m_heartbeat_thread = std::thread(&xheartbeat::run, &m_heartbeat);
+                p_pump->add(m_publisher, nullptr);
+            }
+            else
+            {
+                p_pump->add(m_publisher, &m_heartbeat);
+            }
+            if (p_metrics != nullptr)
+            {
+                m_metrics_thread = std::thread(&xmetrics_endpoint::run, p_metrics.get());
+            }
+            m_started = true;
+        }
 
-        zmq::pollitem_t items[] = {
-            { m_controller, 0, ZMQ_POLLIN, 0 },
-            { m_shell, 0, ZMQ_POLLIN, 0 }
-        };
+        m_request_restart = false;
+        m_request_stop = false;
+        m_shell_thread = std::this_thread::get_id();
 
         publish(message);
 
+        std::thread control_thread(&xcontrol::run, &m_control, [this](zmq::multipart_t& wire_msg)
+        {
+            xserver::notify_control_listener(wire_msg);
+        });
+
+        while (!m_request_stop)
+        {
+            poll_channels(-1);
+        }
+
+        if (m_request_restart)
+        {
+            stop_control();
+            control_thread.join();
+            return;
+        }
+
+        // The pending messages are sent before remove returns
+        stop_channels();
+        control_thread.join();
+        if (m_heartbeat_thread.joinable())
+        {
+            m_heartbeat_thread.join();
+        }
+        if (m_metrics_thread.joinable())
+        {
+            m_metrics_thread.join();
+        }
+        p_pump->remove(m_publisher);
+    }
+
+    void xserver_impl::abort_queue_impl(const listener& l, long grace_period)
+    {
+        // Requests already queued are aborted back to back,
+        // including the ones held by hold_shell.
+        zmq::multipart_t wire_msg;
+        receive_shell();
+        while (!m_request_stop && m_shell_scheduler.pop(wire_msg, true))
+        {
+            l(wire_msg);
+            wire_msg.clear();
+        }
+
+        // Then the requests arriving within the grace period
+        using clock_type = std::chrono::steady_clock;
+        auto deadline = clock_type::now() + std::chrono::milliseconds(grace_period);
         while (!m_request_stop)
         {
-            zmq::poll(&items[0], 2, -1);
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock_type::now());
+            if (remaining.count() <= 0)
+            {
+                return;
+            }
+
+            zmq::pollitem_t items[] = {
+                { m_wakeup_pull, 0, ZMQ_POLLIN, 0 },
+                { m_shell, 0, ZMQ_POLLIN, 0 }
+            };
+            zmq::poll(&items[0], 2, static_cast<long>(remaining.count()));
 
             if (items[0].revents & ZMQ_POLLIN)
             {
-                zmq::multipart_t wire_msg;
-                wire_msg.recv(m_controller);
-                xserver::notify_control_listener(wire_msg);
+                zmq::message_t wakeup_msg;
+                m_wakeup_pull.recv(&wakeup_msg);
+                send_pending_shell();
             }
 
-            if (!m_request_stop && (items[1].revents & ZMQ_POLLIN))
+            receive_shell();
+            while (!m_request_stop && m_shell_scheduler.pop(wire_msg, true))
             {
-                zmq::multipart_t wire_msg;
-                wire_msg.recv(m_shell);
-                xserver::notify_shell_listener(wire_msg);
+                l(wire_msg);
+                wire_msg.clear();
             }
         }
+    }
 
-        stop_channels();
+    void xserver_impl::hold_shell_impl(const std::vector<std::string>& allowed_types)
+    {
+        m_shell_scheduler.hold(allowed_types);
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    void xserver_impl::release_shell_impl()
+    {
+        m_release_shell = true;
+        wakeup();
     }
 
-    void xserver_impl::abort_queue_impl(const listener& l, long polling_interval)
+    void xserver_impl::update_ports_impl(xconfiguration& config) const
     {
-        while (true)
+        update_port(config.m_control_port, m_control.port());
+        update_port(config.m_shell_port, get_bound_port(m_shell));
+        update_port(config.m_stdin_port, get_bound_port(m_stdin));
+        update_port(config.m_iopub_port, m_publisher.port());
+        update_port(config.m_hb_port, m_heartbeat.port());
+        update_port(config.m_iopub_replay_port, m_publisher.replay_port());
+    }
+
+    void xserver_impl::stop_impl()
+    {
+        // May be called from the control thread while the shell thread
+        // is blocked in poll_channels.
+        m_request_stop = true;
+        wakeup();
+    }
+
+    void xserver_impl::restart_impl()
+    {
+        m_request_restart = true;
+        m_request_stop = true;
+        wakeup();
+    }
+
+    void xserver_impl::wakeup()
+    {
+        std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+        zmq::message_t wakeup_msg("wakeup", 6);
+        m_wakeup_push.send(wakeup_msg);
+    }
+
+    void xserver_impl::send_pending_shell()
+    {
+        std::vector<zmq::multipart_t> pending;
         {
-            zmq::multipart_t wire_msg;
-            bool msg = wire_msg.recv(m_shell, ZMQ_NOBLOCK);
-            if (!msg)
+            std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+            pending.swap(m_pending_shell);
+        }
+        for (auto& message : pending)
+        {
+            message.send(m_shell);
+        }
+    }
+
+    void xserver_impl::receive_shell()
+    {
+        // Buffers are imported in the order the requests are received,
+        // which is the order they were written in the shm rings.
+        zmq::multipart_t wire_msg;
+        while (m_shell_scheduler.size() < m_shell_queue_size && wire_msg.recv(m_shell, ZMQ_NOBLOCK))
+        {
+            if (p_shm != nullptr)
             {
-                return;
+                p_shm->import_buffers(wire_msg);
             }
-
-            l(wire_msg);
-            std::this_thread::sleep_for(std::chrono::milliseconds(polling_interval));
+            m_shell_scheduler.push(std::move(wire_msg));
+            wire_msg.clear();
         }
     }
 
-    void xserver_impl::stop_impl()
+    void xserver_impl::poll_channels(long timeout)
     {
-        m_request_stop = true;
+        if (m_release_shell.exchange(false))
+        {
+            m_shell_scheduler.release();
+        }
+
+        zmq::pollitem_t items[] = {
+            { m_wakeup_pull, 0, ZMQ_POLLIN, 0 },
+            { m_stdin, 0, ZMQ_POLLIN, 0 },
+            { m_shell, 0, ZMQ_POLLIN, 0 }
+        };
+
+        // Shell requests are queued while an input_reply is pending,
+        // they are served once the current request has completed. The
+        // shell socket is not polled while the scheduler is full, it
+        // would stay readable.
+        bool serve_shell = !m_input_pending;
+        bool shell_full = m_shell_scheduler.size() >= m_shell_queue_size;
+        int nb_items = (serve_shell && !shell_full) ? 3 : 2;
+        if (serve_shell && !m_shell_scheduler.empty())
+        {
+            timeout = 0;
+        }
+        zmq::poll(&items[0], nb_items, timeout);
+
+        if (items[0].revents & ZMQ_POLLIN)
+        {
+            // Sent by stop_impl, release_shell_impl or send_shell_impl
+            zmq::message_t wakeup_msg;
+            m_wakeup_pull.recv(&wakeup_msg);
+            send_pending_shell();
+        }
+
+        if (items[1].revents & ZMQ_POLLIN)
+        {
+            zmq::multipart_t wire_msg;
+            wire_msg.recv(m_stdin);
+            // Replies arriving after a timeout are dropped
+            if (m_input_pending)
+            {
+                m_input_pending = false;
+                xserver::notify_stdin_listener(wire_msg);
+            }
+        }
+
+        if (!m_request_stop && serve_shell)
+        {
+            // The requests already received are queued, up to
+            // m_shell_queue_size, so that the next one is picked
+            // among all of them.
+            if (nb_items == 3 && (items[2].revents & ZMQ_POLLIN))
+            {
+                receive_shell();
+            }
+
+            zmq::multipart_t wire_msg;
+            if (m_shell_scheduler.pop(wire_msg))
+            {
+                xserver::notify_shell_listener(wire_msg);
+
+                // ZMQ_EVENTS does not wait, it only checks the queue
+                if (!m_request_stop && m_shell_scheduler.empty() &&
+                    !(m_shell.getsockopt<int>(ZMQ_EVENTS) & ZMQ_POLLIN))
+                {
+                    xserver::notify_idle_listener();
+                }
+            }
+        }
     }
 
     void xserver_impl::stop_channels()
     {
+        std::lock_guard<std::mutex> lock(m_publish_mutex);
         zmq::message_t stop_msg("stop", 4);
         m_controller_pub.send(stop_msg);
     }
 
+    void xserver_impl::stop_control()
+    {
+        // Only the control channel subscribes to restart messages
+        std::lock_guard<std::mutex> lock(m_publish_mutex);
+        zmq::message_t restart_msg("restart", 7);
+        m_controller_pub.send(restart_msg);
+    }
+
 }
@@ -9,21 +9,51 @@
 #ifndef XSERVER_IMPL_HPP
 #define XSERVER_IMPL_HPP
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "xeus/xserver.hpp"
 #include "xeus/xkernel_configuration.hpp"
+#include "xcontrol.hpp"
+#include "xmetrics_endpoint.hpp"
 #include "xpublisher.hpp"
+#include "xserver_pump.hpp"
+#include "xshell_scheduler.hpp"
+#include "xshm_transport.hpp"
 #include "xheartbeat.hpp"
 
 namespace xeus
 {
 
+    /**
+     * The control channel is served on a dedicated thread (see xcontrol),
+     * shell and stdin are served on the thread calling start, iopub and
+     * heartbeat by a pump (see xserver_pump). No thread is detached: start
+     * returns once the pending messages have been published. Publishing
+     * and stopping the server are safe from any thread, and so is sending
+     * on shell: messages sent from other threads are queued and sent by
+     * the shell thread. Shell requests already received are dispatched
+     * in the order given by an xshell_scheduler.
+     */
     class xserver_impl : public xserver
     {
 
     public:
 
+        using shm_transport_ptr = std::shared_ptr<xshm_transport>;
+
+        // Binary buffers go through shm when it is not null. The
+        // iopub and heartbeat channels are served by pump, or by a
+        // pump owned by the server when it is null.
         xserver_impl(zmq::context_t& context,
-                     const xconfiguration& config);
+                     const xconfiguration& config,
+                     shm_transport_ptr shm = nullptr,
+                     xserver_pump* pump = nullptr);
 
         virtual ~xserver_impl() = default;
 
@@ -33,23 +63,64 @@ namespace xeus
         void send_control_impl(zmq::multipart_t& message) override;
         void send_stdin_impl(zmq::multipart_t& message) override;
         void publish_impl(zmq::multipart_t& message) override;
+        void publish_message_impl(xpub_message message) override;
+        bool poll_shell_impl(zmq::multipart_t& message) override;
 
         void start_impl(zmq::multipart_t& message) override;
-        void abort_queue_impl(const listener& l, long polling_interval) override;
+        void abort_queue_impl(const listener& l, long grace_period) override;
+        void hold_shell_impl(const std::vector<std::string>& allowed_types) override;
+        void release_shell_impl() override;
+        void update_ports_impl(xconfiguration& config) const override;
         void stop_impl() override;
+        void restart_impl() override;
 
+        void poll_channels(long timeout);
+        void wakeup();
+        void send_pending_shell();
+        void receive_shell();
         void stop_channels();
+        void stop_control();
+
+        // Suffix of the inproc end points
+        std::string m_id;
 
         zmq::socket_t m_shell;
-        zmq::socket_t m_controller;
         zmq::socket_t m_stdin;
         zmq::socket_t m_publisher_pub;
         zmq::socket_t m_controller_pub;
+        zmq::socket_t m_wakeup_push;
+        zmq::socket_t m_wakeup_pull;
 
+        xcontrol m_control;
         xpublisher m_publisher;
         xheartbeat m_heartbeat;
 
-        bool m_request_stop;
+        std::mutex m_publish_mutex;
+        std::mutex m_wakeup_mutex;
+        std::vector<zmq::multipart_t> m_pending_shell;
+        std::thread::id m_shell_thread;
+        xshell_scheduler m_shell_scheduler;
+        // Requests beyond this count are left in the shell socket,
+        // so that its high water mark still applies.
+        std::size_t m_shell_queue_size;
+        // Set by release_shell_impl, the scheduler is only
+        // accessed from the shell thread.
+        std::atomic<bool> m_release_shell;
+
+        long m_stdin_timeout;
+        bool m_input_pending;
+        std::atomic<bool> m_request_stop;
+        std::atomic<bool> m_request_restart;
+        // The iopub and heartbeat channels keep running across restarts
+        bool m_started;
+        shm_transport_ptr p_shm;
+        bool m_dedicated_heartbeat;
+        std::thread m_heartbeat_thread;
+        std::unique_ptr<xmetrics_endpoint> p_metrics;
+        std::thread m_metrics_thread;
+        // Declared after the channels it serves, so that it is destroyed first
+        std::unique_ptr<xserver_pump> p_own_pump;
+        xserver_pump* p_pump;
     };
 
 }
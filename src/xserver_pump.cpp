@@ -0,0 +1,202 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+
+#include "xmiddleware.hpp"
+#include "xserver_pump.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        std::string get_pump_end_point(const std::string& id)
+        {
+            return "inproc://pump-" + id;
+        }
+    }
+
+    xserver_pump::xserver_pump(zmq::context_t& context)
+        : m_id(make_server_id()),
+          m_wakeup_push(context, zmq::socket_type::push),
+          m_wakeup_pull(context, zmq::socket_type::pull),
+          m_generation(0),
+          m_seen_generation(0),
+          m_stop(false)
+    {
+        m_wakeup_pull.setsockopt(ZMQ_LINGER, get_socket_linger());
+        m_wakeup_pull.bind(get_pump_end_point(m_id));
+        m_wakeup_push.setsockopt(ZMQ_LINGER, get_socket_linger());
+        m_wakeup_push.connect(get_pump_end_point(m_id));
+        m_thread = std::thread(&xserver_pump::run, this);
+    }
+
+    xserver_pump::~xserver_pump()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            wakeup();
+        }
+        m_thread.join();
+    }
+
+    void xserver_pump::add(xpublisher& publisher, xheartbeat* heartbeat)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.push_back(entry{&publisher, heartbeat, true, heartbeat != nullptr, 0});
+        ++m_generation;
+        wakeup();
+    }
+
+    void xserver_pump::remove(xpublisher& publisher)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto find_entry = [this, &publisher]()
+        {
+            return std::find_if(m_entries.begin(), m_entries.end(),
+                                [&publisher](const entry& e) { return e.p_publisher == &publisher; });
+        };
+
+        m_updated.wait(lock, [this, &find_entry]()
+        {
+            auto iter = find_entry();
+            return m_stop || iter == m_entries.end() ||
+                (!iter->m_publisher_running && !iter->m_heartbeat_running);
+        });
+
+        auto iter = find_entry();
+        if (iter != m_entries.end())
+        {
+            m_entries.erase(iter);
+            std::uint64_t generation = ++m_generation;
+            wakeup();
+            m_updated.wait(lock, [this, generation]() { return m_stop || m_seen_generation >= generation; });
+        }
+    }
+
+    void xserver_pump::run()
+    {
+        std::vector<entry> entries;
+        std::vector<zmq::pollitem_t> items;
+
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_stop)
+                {
+                    break;
+                }
+                if (m_seen_generation != m_generation)
+                {
+                    entries = m_entries;
+                    // The publisher items of an entry come first
+                    std::size_t size = 1;
+                    for (auto& e : entries)
+                    {
+                        e.m_offset = size;
+                        size += xpublisher::poll_size + (e.p_heartbeat != nullptr ? xheartbeat::poll_size : 0);
+                    }
+                    items.resize(size);
+                    items[0] = { m_wakeup_pull, 0, ZMQ_POLLIN, 0 };
+                    for (auto& e : entries)
+                    {
+                        e.p_publisher->init_poll_items(&items[e.m_offset]);
+                        if (e.p_heartbeat != nullptr)
+                        {
+                            e.p_heartbeat->init_poll_items(&items[e.m_offset + xpublisher::poll_size]);
+                        }
+                    }
+                    m_seen_generation = m_generation;
+                    m_updated.notify_all();
+                }
+            }
+
+            long timeout = -1;
+            for (const auto& e : entries)
+            {
+                // Stopped channels are not polled anymore
+                for (std::size_t j = 0; j < xpublisher::poll_size; ++j)
+                {
+                    items[e.m_offset + j].events = e.m_publisher_running ? ZMQ_POLLIN : 0;
+                }
+                if (e.p_heartbeat != nullptr)
+                {
+                    for (std::size_t j = 0; j < xheartbeat::poll_size; ++j)
+                    {
+                        items[e.m_offset + xpublisher::poll_size + j].events = e.m_heartbeat_running ? ZMQ_POLLIN : 0;
+                    }
+                }
+                if (e.m_publisher_running)
+                {
+                    long publisher_timeout = e.p_publisher->poll_timeout();
+                    if (publisher_timeout >= 0 && (timeout < 0 || publisher_timeout < timeout))
+                    {
+                        timeout = publisher_timeout;
+                    }
+                }
+            }
+
+            zmq::poll(&items[0], items.size(), timeout);
+
+            if (items[0].revents & ZMQ_POLLIN)
+            {
+                zmq::message_t wakeup_msg;
+                while (m_wakeup_pull.recv(&wakeup_msg, ZMQ_NOBLOCK))
+                {
+                }
+            }
+
+            for (auto& e : entries)
+            {
+                zmq::pollitem_t* entry_items = &items[e.m_offset];
+                bool publisher_running = e.m_publisher_running;
+                bool heartbeat_running = e.m_heartbeat_running;
+                if (e.m_publisher_running)
+                {
+                    e.m_publisher_running = e.p_publisher->process(entry_items);
+                }
+                if (e.m_heartbeat_running)
+                {
+                    e.m_heartbeat_running = e.p_heartbeat->process(entry_items + xpublisher::poll_size);
+                }
+                if (publisher_running != e.m_publisher_running ||
+                    heartbeat_running != e.m_heartbeat_running)
+                {
+                    update_running(e, e.m_publisher_running, e.m_heartbeat_running);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_updated.notify_all();
+    }
+
+    void xserver_pump::wakeup()
+    {
+        // Only called with m_mutex locked
+        zmq::message_t wakeup_msg;
+        m_wakeup_push.send(wakeup_msg);
+    }
+
+    void xserver_pump::update_running(const entry& e, bool publisher_running, bool heartbeat_running)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& shared_entry : m_entries)
+        {
+            if (shared_entry.p_publisher == e.p_publisher)
+            {
+                shared_entry.m_publisher_running = publisher_running;
+                shared_entry.m_heartbeat_running = heartbeat_running;
+            }
+        }
+        m_updated.notify_all();
+    }
+
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XSERVER_PUMP_HPP
+#define XSERVER_PUMP_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zmq.hpp"
+
+#include "xheartbeat.hpp"
+#include "xpublisher.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xserver_pump
+     * @brief Serves the iopub and heartbeat channels of several servers on a single thread.
+     *
+     * Servers register their publisher, and their heartbeat unless it
+     * runs on a dedicated thread, when they start.
+     */
+    class xserver_pump
+    {
+    public:
+
+        explicit xserver_pump(zmq::context_t& context);
+        ~xserver_pump();
+
+        xserver_pump(const xserver_pump&) = delete;
+        xserver_pump& operator=(const xserver_pump&) = delete;
+
+        xserver_pump(xserver_pump&&) = delete;
+        xserver_pump& operator=(xserver_pump&&) = delete;
+
+        // heartbeat may be null
+        void add(xpublisher& publisher, xheartbeat* heartbeat);
+        // Must be called once the stop message has been sent to the
+        // publisher and the heartbeat. Returns when their pending
+        // messages have been sent and the pump does not use them anymore.
+        void remove(xpublisher& publisher);
+
+    private:
+
+        struct entry
+        {
+            xpublisher* p_publisher;
+            xheartbeat* p_heartbeat;
+            bool m_publisher_running;
+            bool m_heartbeat_running;
+            // Index of the first poll item of the entry
+            std::size_t m_offset;
+        };
+
+        void run();
+        void wakeup();
+        void update_running(const entry& e, bool publisher_running, bool heartbeat_running);
+
+        std::string m_id;
+        zmq::socket_t m_wakeup_push;
+        zmq::socket_t m_wakeup_pull;
+
+        std::mutex m_mutex;
+        std::condition_variable m_updated;
+        std::vector<entry> m_entries;
+        // Incremented when m_entries changes, m_seen_generation
+        // is the last one used by the pump thread.
+        std::uint64_t m_generation;
+        std::uint64_t m_seen_generation;
+        bool m_stop;
+
+        std::thread m_thread;
+    };
+
+}
+
+#endif
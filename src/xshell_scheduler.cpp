@@ -0,0 +1,130 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstring>
+#include <utility>
+
+#include "xmessage_utils.hpp"
+#include "xshell_scheduler.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const std::string delimiter = "<IDS|MSG>";
+    }
+
+    xshell_scheduler::xshell_scheduler(const std::vector<std::string>& priority_types,
+                                       std::size_t max_burst)
+        : m_priority_types(priority_types),
+          m_max_burst(max_burst == 0 ? 1 : max_burst),
+          m_burst(0),
+          m_held(false)
+    {
+    }
+
+    bool xshell_scheduler::empty() const noexcept
+    {
+        return m_priority.empty() && m_normal.empty();
+    }
+
+    std::size_t xshell_scheduler::size() const noexcept
+    {
+        return m_priority.size() + m_normal.size() + m_waiting.size();
+    }
+
+    void xshell_scheduler::push(zmq::multipart_t message)
+    {
+        if (m_held && !has_type(message, m_allowed_types))
+        {
+            m_waiting.push_back(std::move(message));
+        }
+        else if (has_type(message, m_priority_types))
+        {
+            m_priority.push_back(std::move(message));
+        }
+        else
+        {
+            m_normal.push_back(std::move(message));
+        }
+    }
+
+    bool xshell_scheduler::pop(zmq::multipart_t& message, bool include_held)
+    {
+        if (include_held && m_priority.empty() && m_normal.empty() && !m_waiting.empty())
+        {
+            message = std::move(m_waiting.front());
+            m_waiting.pop_front();
+            return true;
+        }
+
+        bool from_priority = !m_priority.empty() &&
+            (m_normal.empty() || m_burst < m_max_burst);
+        std::deque<zmq::multipart_t>& queue = from_priority ? m_priority : m_normal;
+        if (queue.empty())
+        {
+            return false;
+        }
+        message = std::move(queue.front());
+        queue.pop_front();
+        m_burst = from_priority ? m_burst + 1 : 0;
+        return true;
+    }
+
+    void xshell_scheduler::hold(const std::vector<std::string>& allowed_types)
+    {
+        m_held = true;
+        m_allowed_types = allowed_types;
+    }
+
+    void xshell_scheduler::release()
+    {
+        m_held = false;
+        std::deque<zmq::multipart_t> waiting;
+        waiting.swap(m_waiting);
+        for (auto& message : waiting)
+        {
+            push(std::move(message));
+        }
+    }
+
+    bool xshell_scheduler::has_type(const zmq::multipart_t& message,
+                                    const std::vector<std::string>& types) const
+    {
+        if (types.empty())
+        {
+            return false;
+        }
+
+        // The header follows the delimiter and the signature
+        for (std::size_t i = 0; i + 2 < message.size(); ++i)
+        {
+            const zmq::message_t* frame = message.peek(i);
+            if (frame->size() == delimiter.size() &&
+                std::memcmp(frame->data(), delimiter.c_str(), delimiter.size()) == 0)
+            {
+                const char* type_data;
+                std::size_t type_size;
+                if (!find_string_value(*message.peek(i + 2), "msg_type", type_data, type_size))
+                {
+                    return false;
+                }
+                for (const auto& type : types)
+                {
+                    if (type.size() == type_size && std::memcmp(type.c_str(), type_data, type_size) == 0)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        }
+        return false;
+    }
+
+}
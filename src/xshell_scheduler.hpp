@@ -0,0 +1,73 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XSHELL_SCHEDULER_HPP
+#define XSHELL_SCHEDULER_HPP
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xshell_scheduler
+     * @brief Orders the shell requests received but not yet dispatched.
+     *
+     * Requests whose type is in the priority list are dispatched before
+     * the other ones, which keep their order. After max_burst priority
+     * requests in a row, a pending request of the other queue is
+     * dispatched, so that a flood of cheap requests cannot starve
+     * execute_requests. With an empty priority list, requests are
+     * dispatched in the order they are received. While the scheduler is
+     * held, only the requests of the allowed types are dispatched, the
+     * other ones wait until it is released. They are counted by size,
+     * not by empty.
+     */
+    class xshell_scheduler
+    {
+    public:
+
+        xshell_scheduler(const std::vector<std::string>& priority_types,
+                         std::size_t max_burst);
+
+        bool empty() const noexcept;
+        std::size_t size() const noexcept;
+
+        void push(zmq::multipart_t message);
+        // Returns false if no request is pending. Held requests are only
+        // returned with include_held, once the other ones have been popped.
+        bool pop(zmq::multipart_t& message, bool include_held = false);
+
+        void hold(const std::vector<std::string>& allowed_types);
+        void release();
+
+    private:
+
+        bool has_type(const zmq::multipart_t& message,
+                      const std::vector<std::string>& types) const;
+
+        std::vector<std::string> m_priority_types;
+        std::size_t m_max_burst;
+        std::size_t m_burst;
+        std::deque<zmq::multipart_t> m_priority;
+        std::deque<zmq::multipart_t> m_normal;
+
+        bool m_held;
+        std::vector<std::string> m_allowed_types;
+        std::deque<zmq::multipart_t> m_waiting;
+    };
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "xshm_ring.hpp"
+
+#if (defined(__linux__) || defined(__unix__) || defined(__APPLE__))
+#define POSIX_PLATFORM
+#endif
+
+#if defined(POSIX_PLATFORM)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace xeus
+{
+    namespace
+    {
+        // Keeps the blocks aligned for the peer reading them
+        constexpr std::size_t block_alignment = 64;
+
+        std::size_t align(std::size_t size)
+        {
+            return (size + block_alignment - 1) & ~(block_alignment - 1);
+        }
+    }
+
+    xshm_ring::xshm_ring(const std::string& name, std::size_t capacity)
+        : m_name(name),
+          m_mapped_size(align(sizeof(header)) + align(capacity)),
+          p_segment(nullptr),
+          p_header(nullptr)
+    {
+#if defined(POSIX_PLATFORM)
+        int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd == -1)
+        {
+            throw std::runtime_error("could not create shared memory segment " + m_name);
+        }
+
+        if (ftruncate(fd, static_cast<off_t>(m_mapped_size)) == -1)
+        {
+            close(fd);
+            shm_unlink(m_name.c_str());
+            throw std::runtime_error("could not size shared memory segment " + m_name);
+        }
+
+        p_segment = mmap(nullptr, m_mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p_segment == MAP_FAILED)
+        {
+            shm_unlink(m_name.c_str());
+            throw std::runtime_error("could not map shared memory segment " + m_name);
+        }
+
+        p_header = new (p_segment) header;
+        p_header->m_capacity = align(capacity);
+        p_header->m_head.store(0, std::memory_order_relaxed);
+        p_header->m_tail.store(0, std::memory_order_release);
+#else
+        throw std::runtime_error("shared memory rings require a POSIX platform");
+#endif
+    }
+
+    xshm_ring::~xshm_ring()
+    {
+#if defined(POSIX_PLATFORM)
+        munmap(p_segment, m_mapped_size);
+        shm_unlink(m_name.c_str());
+#endif
+    }
+
+    const std::string& xshm_ring::name() const noexcept
+    {
+        return m_name;
+    }
+
+    bool xshm_ring::write(const void* data, std::size_t size, std::uint64_t& position)
+    {
+        std::uint64_t capacity = p_header->m_capacity;
+        std::uint64_t head = p_header->m_head.load(std::memory_order_relaxed);
+        std::uint64_t tail = p_header->m_tail.load(std::memory_order_acquire);
+        std::uint64_t block_size = align(size);
+
+        std::uint64_t start = head;
+        std::uint64_t offset = head % capacity;
+        if (offset + block_size > capacity)
+        {
+            // The end of the data is skipped
+            start += capacity - offset;
+        }
+
+        if (block_size > capacity || start + block_size - tail > capacity)
+        {
+            return false;
+        }
+
+        std::memcpy(this->data() + start % capacity, data, size);
+        p_header->m_head.store(start + block_size, std::memory_order_release);
+        position = start;
+        return true;
+    }
+
+    const void* xshm_ring::read(std::uint64_t position, std::size_t size) const
+    {
+        std::uint64_t capacity = p_header->m_capacity;
+        std::uint64_t head = p_header->m_head.load(std::memory_order_acquire);
+        std::uint64_t tail = p_header->m_tail.load(std::memory_order_relaxed);
+        if (position < tail || position + size > head || position % capacity + size > capacity)
+        {
+            return nullptr;
+        }
+        return data() + position % capacity;
+    }
+
+    void xshm_ring::release(std::uint64_t position, std::size_t size)
+    {
+        p_header->m_tail.store(position + align(size), std::memory_order_release);
+    }
+
+    char* xshm_ring::data() const noexcept
+    {
+        return static_cast<char*>(p_segment) + align(sizeof(header));
+    }
+
+}
@@ -0,0 +1,79 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XSHM_RING_HPP
+#define XSHM_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace xeus
+{
+
+    /**
+     * @class xshm_ring
+     * @brief Single producer, single consumer byte ring in POSIX shared memory.
+     *
+     * The segment starts with a header holding the capacity and the
+     * producer and consumer positions, followed by the data. Positions
+     * grow monotonically, the offset of a position in the data is its
+     * value modulo the capacity. A block never wraps around the end of the
+     * data: the producer skips the tail of the data instead, and the
+     * consumer releases the padding along with the next block.
+     *
+     * The kernel creates and unlinks the segments, the peer process
+     * opens them by name.
+     */
+    class xshm_ring
+    {
+    public:
+
+        xshm_ring(const std::string& name, std::size_t capacity);
+        ~xshm_ring();
+
+        xshm_ring(const xshm_ring&) = delete;
+        xshm_ring& operator=(const xshm_ring&) = delete;
+
+        xshm_ring(xshm_ring&&) = delete;
+        xshm_ring& operator=(xshm_ring&&) = delete;
+
+        const std::string& name() const noexcept;
+
+        // Producer side: copies size bytes in the ring and sets position
+        // to the start of the block. Returns false if the ring is full.
+        bool write(const void* data, std::size_t size, std::uint64_t& position);
+
+        // Consumer side: returns the block starting at position, or
+        // nullptr if it does not lie in the written part of the ring.
+        // The block remains valid until it is released, blocks must be
+        // released in order.
+        const void* read(std::uint64_t position, std::size_t size) const;
+        void release(std::uint64_t position, std::size_t size);
+
+    private:
+
+        struct header
+        {
+            std::uint64_t m_capacity;
+            std::atomic<std::uint64_t> m_head;
+            std::atomic<std::uint64_t> m_tail;
+        };
+
+        char* data() const noexcept;
+
+        std::string m_name;
+        std::size_t m_mapped_size;
+        void* p_segment;
+        header* p_header;
+    };
+
+}
+
+#endif
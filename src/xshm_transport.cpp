@@ -0,0 +1,147 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "xshm_transport.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const char descriptor_magic[8] = "XSHMBUF";
+        constexpr std::size_t descriptor_size = 24;
+        const std::string delimiter = "<IDS|MSG>";
+        // Delimiter, signature, header, parent header, metadata, content
+        constexpr std::size_t buffer_offset = 6;
+
+        void store_uint64(char* buf, std::uint64_t value)
+        {
+            for (std::size_t i = 0; i < 8; ++i)
+            {
+                buf[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        std::uint64_t load_uint64(const char* buf)
+        {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < 8; ++i)
+            {
+                value |= static_cast<std::uint64_t>(static_cast<unsigned char>(buf[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        bool is_descriptor(const zmq::message_t& frame)
+        {
+            return frame.size() == descriptor_size &&
+                std::memcmp(frame.data(), descriptor_magic, sizeof(descriptor_magic)) == 0;
+        }
+
+        // Index of the first buffer frame, or 0 if the message has none
+        std::size_t first_buffer(const zmq::multipart_t& wire_msg)
+        {
+            for (std::size_t i = 0; i < wire_msg.size(); ++i)
+            {
+                const zmq::message_t* frame = wire_msg.peek(i);
+                if (frame->size() == delimiter.size() &&
+                    std::memcmp(frame->data(), delimiter.c_str(), delimiter.size()) == 0)
+                {
+                    std::size_t index = i + buffer_offset;
+                    return index < wire_msg.size() ? index : 0;
+                }
+            }
+            return 0;
+        }
+
+        // multipart_t only gives access to its parts through pop and add
+        template <class F>
+        void transform_buffers(zmq::multipart_t& wire_msg, std::size_t first, F f)
+        {
+            std::size_t size = wire_msg.size();
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                zmq::message_t frame = wire_msg.pop();
+                if (i >= first)
+                {
+                    frame = f(std::move(frame));
+                }
+                wire_msg.add(std::move(frame));
+            }
+        }
+    }
+
+    xshm_transport::xshm_transport(const xconfiguration& config)
+        : m_iopub_ring(config.m_shm_name + "-iopub", config.m_shm_size),
+          m_shell_ring(config.m_shm_name + "-shell", config.m_shm_size),
+          m_threshold(config.m_shm_threshold)
+    {
+    }
+
+    void xshm_transport::export_buffers(zmq::multipart_t& wire_msg)
+    {
+        std::size_t first = first_buffer(wire_msg);
+        if (first == 0)
+        {
+            return;
+        }
+
+        transform_buffers(wire_msg, first, [this](zmq::message_t frame) -> zmq::message_t
+        {
+            std::uint64_t position;
+            // Small buffers, and buffers that do not fit in the
+            // ring, are sent as regular frames.
+            if (frame.size() < m_threshold ||
+                !m_iopub_ring.write(frame.data(), frame.size(), position))
+            {
+                return frame;
+            }
+            zmq::message_t descriptor(descriptor_size);
+            char* buf = descriptor.data<char>();
+            std::memcpy(buf, descriptor_magic, sizeof(descriptor_magic));
+            store_uint64(buf + 8, position);
+            store_uint64(buf + 16, frame.size());
+            return descriptor;
+        });
+    }
+
+    void xshm_transport::import_buffers(zmq::multipart_t& wire_msg)
+    {
+        std::size_t first = first_buffer(wire_msg);
+        if (first == 0)
+        {
+            return;
+        }
+
+        transform_buffers(wire_msg, first, [this](zmq::message_t frame) -> zmq::message_t
+        {
+            if (!is_descriptor(frame))
+            {
+                return frame;
+            }
+            const char* buf = frame.data<const char>();
+            std::uint64_t position = load_uint64(buf + 8);
+            std::size_t size = static_cast<std::size_t>(load_uint64(buf + 16));
+            const void* data = m_shell_ring.read(position, size);
+            if (data == nullptr)
+            {
+                std::cerr << "ERROR: invalid shared memory buffer descriptor" << std::endl;
+                return zmq::message_t();
+            }
+            // The request may keep its buffers longer than the next
+            // block is received, hence the copy.
+            zmq::message_t res(data, size);
+            m_shell_ring.release(position, size);
+            return res;
+        });
+    }
+
+}
@@ -0,0 +1,59 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XSHM_TRANSPORT_HPP
+#define XSHM_TRANSPORT_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+#include "xeus/xkernel_configuration.hpp"
+#include "xshm_ring.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xshm_transport
+     * @brief Moves the binary buffers of messages through shared memory.
+     *
+     * Buffers published on iopub that are larger than the threshold are
+     * copied to the "<name>-iopub" ring, and the frame sent on the socket
+     * is replaced by a descriptor. Descriptors received on shell refer to
+     * the "<name>-shell" ring, written by the peer; the buffer is copied
+     * out of the ring before the request is handled.
+     *
+     * A descriptor is a 24 bytes frame: the "XSHMBUF" magic string with
+     * its null terminator, then the position and the size of the block
+     * as little-endian 64 bits integers. Buffers are not signed, so
+     * replacing them does not affect the signature of the messages.
+     */
+    class xshm_transport
+    {
+    public:
+
+        explicit xshm_transport(const xconfiguration& config);
+
+        // Called from the iopub thread only
+        void export_buffers(zmq::multipart_t& wire_msg);
+        // Called from the shell thread only
+        void import_buffers(zmq::multipart_t& wire_msg);
+
+    private:
+
+        xshm_ring m_iopub_ring;
+        xshm_ring m_shell_ring;
+        std::size_t m_threshold;
+    };
+
+}
+
+#endif
@@ -0,0 +1,169 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstring>
+#include <utility>
+
+#include "xeus/xjson.hpp"
+#include "xeus/xmessage.hpp"
+#include "xstream_batcher.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        // Layout of a serialized xpub_message
+        constexpr std::size_t topic_index = 0;
+        constexpr std::size_t header_index = 3;
+        constexpr std::size_t parent_header_index = 4;
+        constexpr std::size_t metadata_index = 5;
+        constexpr std::size_t content_index = 6;
+        constexpr std::size_t message_size = 7;
+
+        const std::string stream_suffix = ".stream";
+
+        bool same_frame(const zmq::message_t& lhs, const zmq::message_t& rhs)
+        {
+            return lhs.size() == rhs.size() &&
+                std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+        }
+
+        xjson parse_frame(const zmq::message_t& frame)
+        {
+            const char* buf = frame.data<const char>();
+            return xjson::parse(buf, buf + frame.size());
+        }
+
+        // The frame is shared, not copied
+        xjson_frame share_frame(const zmq::message_t& frame)
+        {
+            zmq::message_t res;
+            res.copy(&frame);
+            return xjson_frame(std::move(res));
+        }
+    }
+
+    xstream_batcher::xstream_batcher(const xauthentication& auth,
+                                     long window,
+                                     std::size_t max_size)
+        : m_auth(auth),
+          m_window(window),
+          m_max_size(max_size),
+          m_count(0)
+    {
+    }
+
+    bool xstream_batcher::enabled() const noexcept
+    {
+        return m_window > 0;
+    }
+
+    bool xstream_batcher::empty() const noexcept
+    {
+        return m_count == 0;
+    }
+
+    bool xstream_batcher::is_stream(const zmq::multipart_t& wire_msg) const
+    {
+        // Extra frames are binary buffers, such messages are never batched
+        if (wire_msg.size() != message_size)
+        {
+            return false;
+        }
+
+        // The topic is "kernel_core.<kernel_id>.<msg_type>", checking
+        // it avoids parsing the header of every forwarded message.
+        const zmq::message_t* topic = wire_msg.peek(topic_index);
+        std::size_t size = topic->size();
+        std::size_t suffix_size = stream_suffix.size();
+        return size >= suffix_size &&
+            std::memcmp(topic->data<const char>() + size - suffix_size,
+                        stream_suffix.c_str(), suffix_size) == 0;
+    }
+
+    bool xstream_batcher::append(zmq::multipart_t& wire_msg)
+    {
+        xjson content = parse_frame(*wire_msg.peek(content_index));
+        std::string name = content.value("name", "");
+        const std::string& text = content["text"].get_ref<const std::string&>();
+
+        if (m_count == 0)
+        {
+            m_name = std::move(name);
+            m_text = text;
+            m_first = std::move(wire_msg);
+            m_count = 1;
+            m_deadline = clock_type::now() + std::chrono::milliseconds(m_window);
+            return true;
+        }
+
+        bool same_batch = name == m_name &&
+            m_text.size() + text.size() <= m_max_size &&
+            same_frame(*wire_msg.peek(parent_header_index), *m_first.peek(parent_header_index));
+        if (!same_batch)
+        {
+            return false;
+        }
+
+        m_text += text;
+        ++m_count;
+        return true;
+    }
+
+    void xstream_batcher::flush(zmq::socket_t& socket)
+    {
+        if (m_count == 0)
+        {
+            return;
+        }
+
+        if (m_count == 1)
+        {
+            // Nothing was merged, the original message is forwarded as is
+            m_first.send(socket);
+        }
+        else
+        {
+            const zmq::message_t* topic = m_first.peek(topic_index);
+            xjson content;
+            content["name"] = std::move(m_name);
+            content["text"] = std::move(m_text);
+            // Only the content is serialized again, the other parts
+            // of the first message are reused as they are.
+            xpub_message msg(std::string(topic->data<const char>(), topic->size()),
+                             share_frame(*m_first.peek(header_index)),
+                             share_frame(*m_first.peek(parent_header_index)),
+                             share_frame(*m_first.peek(metadata_index)),
+                             std::move(content));
+            zmq::multipart_t wire_msg;
+            msg.serialize(wire_msg, m_auth);
+            wire_msg.send(socket);
+        }
+
+        m_first.clear();
+        m_name.clear();
+        m_text.clear();
+        m_count = 0;
+    }
+
+    long xstream_batcher::timeout() const
+    {
+        if (m_count == 0)
+        {
+            return -1;
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(m_deadline - clock_type::now());
+        return remaining.count() > 0 ? static_cast<long>(remaining.count()) : 0;
+    }
+
+    bool xstream_batcher::expired() const
+    {
+        return m_count != 0 && clock_type::now() >= m_deadline;
+    }
+
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XSTREAM_BATCHER_HPP
+#define XSTREAM_BATCHER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+#include "xeus/xauthentication.hpp"
+
+namespace xeus
+{
+
+    /**
+     * @class xstream_batcher
+     * @brief Merges consecutive iopub stream messages.
+     *
+     * Serialized stream messages sharing the same parent header and stream
+     * name are accumulated until the time window elapses, the size limit is
+     * reached, or a message that cannot be merged shows up. The merged
+     * message keeps the header of the first message of the batch.
+     */
+    class xstream_batcher
+    {
+    public:
+
+        using clock_type = std::chrono::steady_clock;
+
+        xstream_batcher(const xauthentication& auth,
+                        long window,
+                        std::size_t max_size);
+
+        bool enabled() const noexcept;
+        bool empty() const noexcept;
+
+        // Returns true if wire_msg is a stream message that can be batched
+        bool is_stream(const zmq::multipart_t& wire_msg) const;
+
+        // Returns false when wire_msg does not belong to the current batch;
+        // the batch must then be flushed before appending again.
+        bool append(zmq::multipart_t& wire_msg);
+        void flush(zmq::socket_t& socket);
+
+        // Time left before the current batch must be flushed, in
+        // milliseconds, or -1 if there is no pending batch.
+        long timeout() const;
+        bool expired() const;
+
+    private:
+
+        const xauthentication& m_auth;
+        long m_window;
+        std::size_t m_max_size;
+
+        zmq::multipart_t m_first;
+        std::string m_name;
+        std::string m_text;
+        std::size_t m_count;
+        clock_type::time_point m_deadline;
+    };
+
+}
+
+#endif
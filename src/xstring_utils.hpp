@@ -12,22 +12,68 @@
 #include <array>
 #include <cstddef>
 #include <string>
-#include <sstream>
-#include <iomanip>
 
 namespace xeus
 {
 
-    template <class T, std::size_t N>
-    inline std::string hex_string(const std::array<T, N>& buffer)
+    // Writes the 2 * size hexadecimal characters of data into out
+    inline void hex_encode(const unsigned char* data, std::size_t size, char* out) noexcept
     {
-        std::ostringstream oss;
-        oss << std::hex;
-        for (std::size_t i = 0; i < N; ++i)
+        static constexpr char digits[] = "0123456789abcdef";
+        for (std::size_t i = 0; i < size; ++i)
         {
-            oss << std::setw(2) << std::setfill('0') << static_cast<int>(buffer[i]);
+            out[2 * i] = digits[data[i] >> 4];
+            out[2 * i + 1] = digits[data[i] & 0x0F];
         }
-        return oss.str();
+    }
+
+    // Returns the value of an hexadecimal digit, or -1 for any other character
+    inline int hex_value(char c) noexcept
+    {
+        static constexpr signed char table[256] = {
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+             0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+            -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+        };
+        return table[static_cast<unsigned char>(c)];
+    }
+
+    // Decodes 2 * size hexadecimal characters from in into out. Returns
+    // false if in contains a non hexadecimal character.
+    inline bool hex_decode(const char* in, std::size_t size, unsigned char* out) noexcept
+    {
+        int invalid = 0;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            int high = hex_value(in[2 * i]);
+            int low = hex_value(in[2 * i + 1]);
+            invalid |= high | low;
+            out[i] = static_cast<unsigned char>(((high & 0x0F) << 4) | (low & 0x0F));
+        }
+        // Invalid digits are negative, hence have their sign bit set
+        return invalid >= 0;
+    }
+
+    template <class T, std::size_t N>
+    inline std::string hex_string(const std::array<T, N>& buffer)
+    {
+        static_assert(sizeof(T) == 1, "hex_string requires a byte buffer");
+        std::string res(2 * N, '0');
+        hex_encode(reinterpret_cast<const unsigned char*>(buffer.data()), N, &res[0]);
+        return res;
     }
 
 }
@@ -0,0 +1,71 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <utility>
+
+#include "xthread_pool.hpp"
+
+namespace xeus
+{
+
+    xthread_pool::xthread_pool(std::size_t size)
+        : m_stop(false)
+    {
+        if (size == 0)
+        {
+            size = 1;
+        }
+        m_workers.reserve(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            m_workers.emplace_back(&xthread_pool::run, this);
+        }
+    }
+
+    xthread_pool::~xthread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    void xthread_pool::submit(task_type task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    void xthread_pool::run()
+    {
+        while (true)
+        {
+            task_type task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTHREAD_POOL_HPP
+#define XTHREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace xeus
+{
+
+    /**
+     * @class xthread_pool
+     * @brief Fixed size pool of threads running tasks in submission order.
+     *
+     * Pending tasks are still run when the pool is destroyed, the
+     * destructor returns once every worker has been joined.
+     */
+    class xthread_pool
+    {
+    public:
+
+        using task_type = std::function<void()>;
+
+        explicit xthread_pool(std::size_t size);
+        ~xthread_pool();
+
+        xthread_pool(const xthread_pool&) = delete;
+        xthread_pool& operator=(const xthread_pool&) = delete;
+
+        xthread_pool(xthread_pool&&) = delete;
+        xthread_pool& operator=(xthread_pool&&) = delete;
+
+        void submit(task_type task);
+
+    private:
+
+        void run();
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::queue<task_type> m_tasks;
+        std::vector<std::thread> m_workers;
+        bool m_stop;
+    };
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <chrono>
+#include <ctime>
+
+#include "xtimestamp.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        // Position of the sub-second digits in the formatted string
+        constexpr std::size_t fraction_offset = 20;
+        constexpr std::size_t fraction_size = 6;
+
+        struct xclock_cache
+        {
+            xclock_cache()
+            {
+                m_buffer[fraction_offset - 1] = '.';
+                m_buffer[iso8601_size - 1] = 'Z';
+                m_buffer[iso8601_size] = '\0';
+            }
+
+            long long m_second = -1;
+            char m_buffer[iso8601_size + 1];
+        };
+    }
+
+    const char* iso8601_timestamp()
+    {
+        thread_local xclock_cache cache;
+
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        long long micros = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+        long long second = micros / 1000000;
+        long long fraction = micros % 1000000;
+
+        if (second != cache.m_second)
+        {
+            std::time_t t = static_cast<std::time_t>(second);
+            std::tm tm;
+#ifdef _WIN32
+            gmtime_s(&tm, &t);
+#else
+            gmtime_r(&t, &tm);
+#endif
+            // strftime writes a null character at the position of
+            // the '.', which is restored right after.
+            std::strftime(cache.m_buffer, fraction_offset, "%Y-%m-%dT%H:%M:%S", &tm);
+            cache.m_buffer[fraction_offset - 1] = '.';
+            cache.m_second = second;
+        }
+
+        for (std::size_t i = 0; i < fraction_size; ++i)
+        {
+            cache.m_buffer[fraction_offset + fraction_size - 1 - i] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        return cache.m_buffer;
+    }
+
+}
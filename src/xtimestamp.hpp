@@ -0,0 +1,28 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTIMESTAMP_HPP
+#define XTIMESTAMP_HPP
+
+#include <cstddef>
+
+namespace xeus
+{
+
+    // Size of "2016-12-02T15:10:00.123456Z"
+    constexpr std::size_t iso8601_size = 27;
+
+    // Returns the current UTC time formatted as an ISO 8601 string with a
+    // microsecond resolution. The buffer is owned by the calling thread and
+    // is overwritten by the next call; the date and time part is only
+    // reformatted when the second changes.
+    const char* iso8601_timestamp();
+
+}
+
+#endif
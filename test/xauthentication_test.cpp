@@ -0,0 +1,81 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+#include "xeus/xauthentication.hpp"
+#include "xeus/xmessage.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        const std::string key = "a0436f6c-1916-498b-8eb9-e81ab9368e84";
+
+        zmq::message_t make_frame(const std::string& value)
+        {
+            return zmq::message_t(value.begin(), value.end());
+        }
+
+        std::string to_string(const zmq::message_t& frame)
+        {
+            return std::string(frame.data<const char>(), frame.size());
+        }
+
+        // The header is signed before the content fails to serialize
+        void serialize_invalid_message(const xauthentication& auth)
+        {
+            xjson content;
+            content["text"] = "\xff\xfe";
+            xpub_message msg("stream",
+                             make_header("stream", "test", "session"),
+                             xjson::object(),
+                             xjson::object(),
+                             std::move(content));
+            zmq::multipart_t wire_msg;
+            EXPECT_ANY_THROW(msg.serialize(wire_msg, auth));
+        }
+
+        void check_signature_after_failure(const std::string& scheme)
+        {
+            std::unique_ptr<xauthentication> auth = make_xauthentication(scheme, key);
+            std::unique_ptr<xauthentication> reference = make_xauthentication(scheme, key);
+
+            zmq::message_t header = make_frame("{\"msg_type\":\"status\"}");
+            zmq::message_t parent_header = make_frame("{}");
+            zmq::message_t metadata = make_frame("{}");
+            zmq::message_t content = make_frame("{\"execution_state\":\"idle\"}");
+            zmq::message_t expected = reference->sign(header, parent_header, metadata, content);
+
+            // The contexts are acquired from the same thread, hence
+            // from the same slot of the pool.
+            serialize_invalid_message(*auth);
+            zmq::message_t signature = auth->sign(header, parent_header, metadata, content);
+            EXPECT_EQ(to_string(signature), to_string(expected));
+
+            serialize_invalid_message(*auth);
+            EXPECT_TRUE(auth->verify(expected, header, parent_header, metadata, content));
+        }
+    }
+
+    TEST(xauthentication, hmac_restarts_unfinalized_signer)
+    {
+        check_signature_after_failure("hmac-sha256");
+    }
+
+    TEST(xauthentication, blake2b_restarts_unfinalized_signer)
+    {
+        check_signature_after_failure("blake2b");
+    }
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "xeus/xjson.hpp"
+#include "xeus/xkernel_configuration.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        xjson make_connection_info()
+        {
+            xjson doc;
+            doc["transport"] = "tcp";
+            doc["ip"] = "127.0.0.1";
+            doc["control_port"] = 50160;
+            doc["shell_port"] = 57503;
+            doc["stdin_port"] = 52597;
+            doc["iopub_port"] = 40885;
+            doc["hb_port"] = 42540;
+            doc["signature_scheme"] = "hmac-sha256";
+            doc["key"] = "a0436f6c-1916-498b-8eb9-e81ab9368e84";
+            return doc;
+        }
+
+        xconfiguration load(const xjson& doc)
+        {
+            const std::string file_name = "xkernel_configuration_test.json";
+            {
+                std::ofstream ofs(file_name);
+                ofs << doc;
+            }
+            xconfiguration res = load_configuration(file_name);
+            std::remove(file_name.c_str());
+            return res;
+        }
+    }
+
+    // Shell requests are handled in the order they are received
+    // unless the priority dispatch is enabled.
+    TEST(xkernel_configuration, shell_priority_is_disabled_by_default)
+    {
+        xconfiguration config;
+        EXPECT_TRUE(config.m_shell_priority.empty());
+        EXPECT_TRUE(load(make_connection_info()).m_shell_priority.empty());
+    }
+
+    TEST(xkernel_configuration, shell_priority)
+    {
+        xjson doc = make_connection_info();
+        doc["shell_priority"] = { "kernel_info_request" };
+        std::vector<std::string> expected = { "kernel_info_request" };
+        EXPECT_EQ(load(doc).m_shell_priority, expected);
+    }
+}
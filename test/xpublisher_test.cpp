@@ -0,0 +1,110 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille and Sylvain Corlay                     *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "zmq.hpp"
+#include "zmq_addon.hpp"
+
+#include "xeus/xauthentication.hpp"
+#include "xeus/xkernel_configuration.hpp"
+#include "xeus/xmessage.hpp"
+#include "xeus/xserver.hpp"
+
+namespace xeus
+{
+    namespace
+    {
+        xconfiguration make_test_configuration()
+        {
+            xconfiguration config;
+            config.m_transport = "tcp";
+            config.m_ip = "127.0.0.1";
+            config.m_control_port = "0";
+            config.m_shell_port = "0";
+            config.m_stdin_port = "0";
+            config.m_iopub_port = "0";
+            config.m_hb_port = "0";
+            config.m_signature_scheme = "hmac-sha256";
+            config.m_key = "a0436f6c-1916-498b-8eb9-e81ab9368e84";
+            return config;
+        }
+
+        xpub_message make_stream_message(const std::string& topic, const std::string& text)
+        {
+            xjson content;
+            content["name"] = "stdout";
+            content["text"] = text;
+            return xpub_message(topic,
+                                make_header("stream", "test", "session"),
+                                xjson::object(),
+                                xjson::object(),
+                                std::move(content));
+        }
+
+        // Returns the topic of the next message published on iopub,
+        // or an empty string when none is received before the timeout.
+        std::string receive_topic(zmq::socket_t& iopub)
+        {
+            zmq::multipart_t wire_msg;
+            if (!wire_msg.recv(iopub))
+            {
+                return "";
+            }
+            return wire_msg.popstr();
+        }
+    }
+
+    TEST(xpublisher, drops_messages_that_cannot_be_serialized)
+    {
+        zmq::context_t context;
+        xconfiguration config = make_test_configuration();
+        std::unique_ptr<xserver> server = make_xserver(context, config);
+        server->update_ports(config);
+
+        zmq::socket_t iopub(context, zmq::socket_type::sub);
+        iopub.setsockopt(ZMQ_LINGER, 0);
+        iopub.setsockopt(ZMQ_RCVTIMEO, 100);
+        iopub.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+        iopub.connect("tcp://127.0.0.1:" + config.m_iopub_port);
+
+        std::unique_ptr<xauthentication> auth = make_xauthentication(config.m_signature_scheme, config.m_key);
+        zmq::multipart_t start_msg;
+        make_stream_message("start", "").serialize(start_msg, *auth);
+        std::thread server_thread([&server, &start_msg]() { server->start(start_msg); });
+
+        // Messages published before the subscription is
+        // established are lost.
+        bool subscribed = false;
+        for (int i = 0; i < 50 && !subscribed; ++i)
+        {
+            server->publish(make_stream_message("ping", "ping"));
+            subscribed = receive_topic(iopub) == "ping";
+        }
+        ASSERT_TRUE(subscribed);
+
+        server->publish(make_stream_message("invalid", "\xff\xfe"));
+        server->publish(make_stream_message("valid", "valid"));
+
+        std::string topic;
+        do
+        {
+            topic = receive_topic(iopub);
+            EXPECT_NE(topic, "invalid");
+        }
+        while (!topic.empty() && topic != "valid");
+        EXPECT_EQ(topic, "valid");
+
+        server->stop();
+        server_thread.join();
+    }
+}